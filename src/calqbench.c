@@ -0,0 +1,132 @@
+/** @file calqbench.c
+ */
+
+/*
+ * Future-event set benchmark: the classic hold model, in which a simulator
+ * repeatedly takes its earliest event and schedules a later one, run on the
+ * calendar queue and on the binary heap with the same sequence of times.
+ * The increments are drawn from an exponential and a uniform distribution,
+ * and from the mix a trace with I/O produces: mostly short CPU bursts with
+ * an occasional long I/O wait.
+ *
+ * Usage: calqbench [<holds> [<largest queue>]]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#include "libcalqueue/libcalqueue.h"
+#include "libheap/libheap.h"
+
+typedef struct _event_t
+{
+	long long time;
+} event_t;
+
+static long long event_time(const void *a)
+{
+	return ((const event_t *)a)->time;
+}
+
+static int compare_events(const void *a, const void *b)
+{
+	long long time_a = ((const event_t *)a)->time, time_b = ((const event_t *)b)->time;
+	return (time_a > time_b) - (time_a < time_b);
+}
+
+typedef enum { EXPONENTIAL, UNIFORM, BURSTS, NUM_DISTRIBUTIONS } distribution_t;
+
+static const char *distribution_names[NUM_DISTRIBUTIONS] = { "exponential", "uniform", "bursts + I/O" };
+
+/*
+ * The gap to an event's next occurrence, in time units.
+ */
+static long long increment(distribution_t distribution, unsigned int *seed)
+{
+	double u = (rand_r(seed) + 1.0) / (RAND_MAX + 2.0);
+
+	switch (distribution)
+	{
+		case EXPONENTIAL:
+			return (long long)(-100 * log(u));
+		case UNIFORM:
+			return rand_r(seed) % 201;
+		default:
+			return (rand_r(seed) % 10 == 0) ? (long long)(-1000 * log(u)) : 1 + (long long)(-5 * log(u));
+	}
+}
+
+static double seconds_since(struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/*
+ * Returns the nanoseconds per hold of a queue of size events, on the
+ * calendar queue or the heap.
+ */
+static double hold_time(int use_calendar, distribution_t distribution, int size, int holds)
+{
+	event_t *events = malloc(size * sizeof(event_t));
+	unsigned int seed = 42;
+	struct timespec start;
+	calqueue_t calendar;
+	heap_t heap;
+	int i;
+
+	calqueue_init(&calendar, event_time);
+	heap_init(&heap, compare_events);
+	for (i = 0; i < size; i++)
+	{
+		events[i].time = increment(distribution, &seed);
+		if (use_calendar)
+			calqueue_push(&calendar, &events[i]);
+		else
+			heap_push(&heap, &events[i]);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < holds; i++)
+	{
+		event_t *event = use_calendar ? calqueue_poll(&calendar) : heap_poll(&heap);
+		event->time += increment(distribution, &seed);
+		if (use_calendar)
+			calqueue_push(&calendar, event);
+		else
+			heap_push(&heap, event);
+	}
+	double elapsed = seconds_since(&start);
+
+	calqueue_destroy(&calendar);
+	heap_destroy(&heap);
+	free(events);
+
+	return elapsed * 1e9 / holds;
+}
+
+int main(int argc, char **argv)
+{
+	int holds = (argc > 1) ? atoi(argv[1]) : 2000000;
+	int largest = (argc > 2) ? atoi(argv[2]) : 1000000;
+	int size, d;
+
+	if (holds <= 0 || largest <= 0)
+	{
+		fprintf(stderr, "Usage: %s [<holds> [<largest queue>]]\n", argv[0]);
+		return 1;
+	}
+
+	printf("%d holds per run, ns per hold\n", holds);
+	printf("Events    Increments    calendar queue  binary heap\n");
+	for (size = 100; size <= largest; size *= 10)
+		for (d = 0; d < NUM_DISTRIBUTIONS; d++)
+			printf("%7d  %-13s  %14.1f  %11.1f\n", size, distribution_names[d],
+					hold_time(1, d, size, holds), hold_time(0, d, size, holds));
+
+	return 0;
+}
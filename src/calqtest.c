@@ -0,0 +1,110 @@
+/** @file calqtest.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "libcalqueue/libcalqueue.h"
+
+typedef struct _event_t
+{
+	long long time;
+	int order;
+} event_t;
+
+long long event_time(const void *a)
+{
+	return ((const event_t *)a)->time;
+}
+
+int main()
+{
+	calqueue_t q;
+
+	calqueue_init(&q, event_time);
+
+	/* Pupulate some data... */
+	event_t *events = malloc(10000 * sizeof(event_t));
+
+	int i;
+	for (i = 0; i < 10000; i++)
+	{
+		events[i].time = i;
+		events[i].order = i;
+	}
+
+	calqueue_push(&q, &events[14]);
+	calqueue_push(&q, &events[12]);
+	calqueue_push(&q, &events[13]);
+	printf("Total elements: %d (expected 3).\n", calqueue_size(&q));
+	printf("Min element: %lld (expected 12).\n", ((event_t *)calqueue_peek(&q))->time);
+	printf("Polled element: %lld (expected 12).\n", ((event_t *)calqueue_poll(&q))->time);
+
+	/* Earlier than the last one polled. */
+	calqueue_push(&q, &events[5]);
+	printf("Min element: %lld (expected 5).\n", ((event_t *)calqueue_peek(&q))->time);
+	calqueue_poll(&q);
+	calqueue_poll(&q);
+	calqueue_poll(&q);
+	printf("Poll on empty: %p (expected (nil)).\n", calqueue_poll(&q));
+
+	/* Scrambled inserts, with gaps far wider than a year, drain in order. */
+	for (i = 0; i < 10000; i++)
+		events[i].time = (i * 7919LL) % 10000 * ((i % 100 == 0) ? 100000 : 1);
+	for (i = 0; i < 10000; i++)
+		calqueue_push(&q, &events[i]);
+	printf("Total elements: %d (expected 10000).\n", calqueue_size(&q));
+
+	void **all = malloc(10000 * sizeof(void *));
+	printf("As an array: %d (expected 10000).\n", calqueue_to_array(&q, all));
+
+	long long last = -1;
+	int sorted = 1;
+	while (calqueue_size(&q) > 0)
+	{
+		event_t *event = calqueue_poll(&q);
+		if (event->time < last)
+			sorted = 0;
+		last = event->time;
+	}
+	printf("Drained in order: %d (expected 1).\n", sorted);
+
+	/* Equal times leave in the order they came, through resizes. */
+	for (i = 0; i < 10000; i++)
+	{
+		events[i].time = i / 1000;
+		calqueue_push(&q, &events[i]);
+	}
+	int fifo = 1;
+	for (i = 0; i < 10000; i++)
+		if (((event_t *)calqueue_poll(&q))->order != i)
+			fifo = 0;
+	printf("Equal times in arrival order: %d (expected 1).\n", fifo);
+
+	/* Hold: each polled event comes back later, as a simulator's would. */
+	for (i = 0; i < 1000; i++)
+	{
+		events[i].time = rand() % 1000;
+		calqueue_push(&q, &events[i]);
+	}
+	last = -1;
+	sorted = 1;
+	for (i = 0; i < 100000; i++)
+	{
+		event_t *event = calqueue_poll(&q);
+		if (event->time < last)
+			sorted = 0;
+		last = event->time;
+		event->time += 1 + rand() % ((i % 7 == 0) ? 5000 : 50);
+		calqueue_push(&q, event);
+	}
+	printf("Hold in order: %d (expected 1).\n", sorted);
+	printf("Total elements: %d (expected 1000).\n", calqueue_size(&q));
+
+	calqueue_destroy(&q);
+
+	free(all);
+	free(events);
+
+	return 0;
+}
@@ -0,0 +1,455 @@
+/** @file cluster.c
+ */
+
+/*
+ * Cluster simulation: nodes of the same number of cores, each with its own
+ * scheduler instance, behind a front-end dispatcher.  Time advances from
+ * event to event (an arrival, a job finishing or a quantum expiring) rather
+ * than tick by tick.  At each event time the main thread routes the jobs
+ * arriving then, and the worker threads, each owning a fixed range of the
+ * nodes, make the scheduler calls of their nodes for that time; a pair of
+ * barriers separates the two phases.  Nodes share nothing, so the result
+ * does not depend on the number of threads.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "cluster.h"
+#include "libhistogram/libhistogram.h"
+
+
+typedef struct _node_t
+{
+	scheduler_t *scheduler;
+	int *core_job;                 // job running on each core, -1 when idle
+	scheduler_time_t *quantum_end; // time the quantum of each core expires, -1 for none
+	int *pending;                  // jobs routed to the node at the current time
+	scheduler_arrival_t *batch;
+	int *batch_cores;
+	int pending_count, capacity;
+	scheduler_time_t last_time;    // time remaining[] was last brought up to date
+	scheduler_time_t next_event;   // earliest finish or quantum expiry, LLONG_MAX when idle
+	long long in_flight;           // routed but not finished, the dispatcher's load
+	long long routed;
+	scheduler_time_t makespan;
+	histogram_t latency[NUM_METRICS];
+} node_t;
+
+typedef struct _worker_t
+{
+	pthread_t thread;
+	int first_node, last_node;     // owns nodes [first_node, last_node)
+	scheduler_time_t next_event;   // earliest next_event of its nodes
+} worker_t;
+
+static const cluster_config_t *config;
+static const cluster_job_t *jobs;
+static scheduler_time_t *remaining, *start;
+static node_t *nodes;
+static worker_t *workers;
+static int time_sliced;
+
+static pthread_barrier_t step_start, step_end;
+static scheduler_time_t step_time;
+static int done;
+
+
+static scheduler_time_t node_quantum(int core_id)
+{
+	if (config->policy == NULL && config->scheme == CFS)
+		return scheduler_time_slice(core_id);
+
+	return config->quantum;
+}
+
+/*
+ * Puts job (or nothing, for -1) on a core of node.
+ */
+static void run_on_core(node_t *node, int core_id, int job, scheduler_time_t time)
+{
+	node->core_job[core_id] = job;
+	node->quantum_end[core_id] = -1;
+	if (job == -1)
+		return;
+
+	if (start[job] == -1)
+		start[job] = time;
+	if (time_sliced)
+		node->quantum_end[core_id] = time + node_quantum(core_id);
+}
+
+static void finish_job(node_t *node, int job, scheduler_time_t time)
+{
+	scheduler_time_t turnaround = time - jobs[job].arrival_time;
+
+	histogram_record(&node->latency[METRIC_WAITING], turnaround - jobs[job].run_time);
+	histogram_record(&node->latency[METRIC_TURNAROUND], turnaround);
+	histogram_record(&node->latency[METRIC_RESPONSE], start[job] - jobs[job].arrival_time);
+	node->in_flight--;
+	node->makespan = time;
+}
+
+/*
+ * Makes the scheduler calls of one node for time: finished jobs, expired
+ * quanta, then arrivals, in the same order as the single machine simulator.
+ */
+static void process_node(node_t *node, scheduler_time_t time)
+{
+	int i, cores = config->cores;
+
+	scheduler_select(node->scheduler);
+
+	for (i = 0; i < cores; i++)
+		if (node->core_job[i] != -1)
+			remaining[node->core_job[i]] -= time - node->last_time;
+	node->last_time = time;
+
+	for (i = 0; i < cores; i++)
+	{
+		int job = node->core_job[i];
+		if (job != -1 && remaining[job] == 0)
+		{
+			finish_job(node, job, time);
+			run_on_core(node, i, scheduler_job_finished(i, job, time), time);
+		}
+	}
+
+	for (i = 0; i < cores; i++)
+		if (node->quantum_end[i] == time && node->core_job[i] != -1)
+			run_on_core(node, i, scheduler_quantum_expired(i, time), time);
+
+	if (node->pending_count > 0)
+	{
+		for (i = 0; i < node->pending_count; i++)
+		{
+			const cluster_job_t *job = &jobs[node->pending[i]];
+			node->batch[i].job_number = node->pending[i];
+			node->batch[i].running_time = job->run_time;
+			node->batch[i].priority = job->priority;
+			node->batch[i].deadline = job->deadline;
+		}
+		scheduler_new_jobs(time, node->batch, node->pending_count, node->batch_cores);
+		for (i = 0; i < node->pending_count; i++)
+			if (node->batch_cores[i] != -1)
+				run_on_core(node, node->batch_cores[i], node->pending[i], time);
+		node->pending_count = 0;
+	}
+
+	node->next_event = LLONG_MAX;
+	for (i = 0; i < cores; i++)
+	{
+		int job = node->core_job[i];
+		if (job == -1)
+			continue;
+
+		scheduler_time_t event = time + remaining[job];
+		if (node->quantum_end[i] != -1 && node->quantum_end[i] < event)
+			event = node->quantum_end[i];
+		if (event < node->next_event)
+			node->next_event = event;
+	}
+}
+
+static void run_step(worker_t *worker)
+{
+	int i;
+
+	worker->next_event = LLONG_MAX;
+	for (i = worker->first_node; i < worker->last_node; i++)
+	{
+		if (nodes[i].pending_count > 0 || nodes[i].next_event == step_time)
+			process_node(&nodes[i], step_time);
+		if (nodes[i].next_event < worker->next_event)
+			worker->next_event = nodes[i].next_event;
+	}
+}
+
+/*
+ * The other workers; the main thread simulates the nodes of workers[0].
+ */
+static void *worker_main(void *arg)
+{
+	worker_t *worker = (worker_t *)arg;
+
+	while (1)
+	{
+		pthread_barrier_wait(&step_start);
+		if (done)
+			break;
+		run_step(worker);
+		pthread_barrier_wait(&step_end);
+	}
+
+	return NULL;
+}
+
+/*
+ * The front-end dispatcher: picks the node an arriving job goes to.
+ */
+static int route(unsigned int *seed)
+{
+	static int next_node = 0;
+	int i, best = 0;
+
+	switch (config->dispatch)
+	{
+		case DISPATCH_LEAST:
+			for (i = 1; i < config->nodes; i++)
+				if (nodes[i].in_flight < nodes[best].in_flight)
+					best = i;
+			return best;
+
+		case DISPATCH_P2C:
+		{
+			if (config->nodes == 1)
+				return 0;
+
+			int a = rand_r(seed) % config->nodes;
+			int b = rand_r(seed) % (config->nodes - 1);
+			if (b >= a)
+				b++;
+			return (nodes[b].in_flight < nodes[a].in_flight) ? b : a;
+		}
+
+		default:
+			best = next_node;
+			next_node = (next_node + 1) % config->nodes;
+			return best;
+	}
+}
+
+static void queue_arrival(node_t *node, int job)
+{
+	if (node->pending_count == node->capacity)
+	{
+		node->capacity = (node->capacity == 0) ? 4 : node->capacity * 2;
+		node->pending = realloc(node->pending, node->capacity * sizeof(int));
+		node->batch = realloc(node->batch, node->capacity * sizeof(scheduler_arrival_t));
+		node->batch_cores = realloc(node->batch_cores, node->capacity * sizeof(int));
+	}
+	node->pending[node->pending_count++] = job;
+	node->in_flight++;
+	node->routed++;
+}
+
+static int compare_arrivals(const void *a, const void *b)
+{
+	int job_a = *(const int *)a, job_b = *(const int *)b;
+
+	if (jobs[job_a].arrival_time != jobs[job_b].arrival_time)
+		return (jobs[job_a].arrival_time > jobs[job_b].arrival_time) - (jobs[job_a].arrival_time < jobs[job_b].arrival_time);
+	return job_a - job_b;
+}
+
+static void print_latency(const char *name, histogram_t *h)
+{
+	printf("  %-11s mean %9.2f  p50 %7llu  p90 %7llu  p99 %7llu  p99.9 %7llu  max %7llu\n", name,
+			histogram_mean(h), histogram_percentile(h, 50), histogram_percentile(h, 90),
+			histogram_percentile(h, 99), histogram_percentile(h, 99.9), histogram_percentile(h, 100));
+}
+
+/*
+ * Runs jobs (count of them, in any order) on the cluster described by
+ * cluster_config with threads worker threads, leaving the finished nodes in
+ * nodes.  Returns the number of event times simulated.
+ */
+static long long simulate(const cluster_config_t *cluster_config, const cluster_job_t *cluster_jobs, int count, int threads)
+{
+	int i, m;
+	unsigned int seed = cluster_config->seed;
+
+	config = cluster_config;
+	jobs = cluster_jobs;
+	time_sliced = (config->quantum > 0 || (config->policy == NULL && config->scheme == CFS));
+
+	int *order = malloc(count * sizeof(int));
+	remaining = malloc(count * sizeof(scheduler_time_t));
+	start = malloc(count * sizeof(scheduler_time_t));
+	for (i = 0; i < count; i++)
+	{
+		order[i] = i;
+		remaining[i] = jobs[i].run_time;
+		start[i] = -1;
+	}
+	qsort(order, count, sizeof(int), compare_arrivals);
+
+	nodes = calloc(config->nodes, sizeof(node_t));
+	for (i = 0; i < config->nodes; i++)
+	{
+		node_t *node = &nodes[i];
+		node->scheduler = scheduler_create();
+		scheduler_select(node->scheduler);
+		if (config->policy != NULL)
+			scheduler_start_up_policy(config->cores, config->policy);
+		else
+			scheduler_start_up(config->cores, config->scheme);
+		if (config->policy == NULL && config->scheme == CFS)
+			scheduler_set_target_latency(config->latency);
+
+		node->core_job = malloc(config->cores * sizeof(int));
+		node->quantum_end = malloc(config->cores * sizeof(scheduler_time_t));
+		for (m = 0; m < config->cores; m++)
+		{
+			node->core_job[m] = -1;
+			node->quantum_end[m] = -1;
+		}
+		node->next_event = LLONG_MAX;
+		for (m = 0; m < NUM_METRICS; m++)
+			histogram_init(&node->latency[m]);
+	}
+	scheduler_select(NULL);
+
+	pthread_barrier_init(&step_start, NULL, threads);
+	pthread_barrier_init(&step_end, NULL, threads);
+	done = 0;
+	workers = malloc(threads * sizeof(worker_t));
+	for (i = 0; i < threads; i++)
+	{
+		workers[i].first_node = (long long)config->nodes * i / threads;
+		workers[i].last_node = (long long)config->nodes * (i + 1) / threads;
+		workers[i].next_event = LLONG_MAX;
+		if (i > 0)
+			pthread_create(&workers[i].thread, NULL, worker_main, &workers[i]);
+	}
+
+	int next_arrival = 0;
+	long long steps = 0;
+	while (1)
+	{
+		scheduler_time_t time = (next_arrival < count) ? jobs[order[next_arrival]].arrival_time : LLONG_MAX;
+		for (i = 0; i < threads; i++)
+			if (workers[i].next_event < time)
+				time = workers[i].next_event;
+		if (time == LLONG_MAX)
+			break;
+
+		while (next_arrival < count && jobs[order[next_arrival]].arrival_time == time)
+			queue_arrival(&nodes[route(&seed)], order[next_arrival++]);
+
+		step_time = time;
+		pthread_barrier_wait(&step_start);
+		run_step(&workers[0]);
+		pthread_barrier_wait(&step_end);
+		steps++;
+	}
+
+	done = 1;
+	pthread_barrier_wait(&step_start);
+	for (i = 1; i < threads; i++)
+		pthread_join(workers[i].thread, NULL);
+	pthread_barrier_destroy(&step_start);
+	pthread_barrier_destroy(&step_end);
+	free(workers);
+	free(order);
+
+	return steps;
+}
+
+/*
+ * Merges the latency histograms of all nodes into total[NUM_METRICS].
+ */
+static void merge_latency(histogram_t *total)
+{
+	int i, m;
+
+	for (i = 0; i < config->nodes; i++)
+		for (m = 0; m < NUM_METRICS; m++)
+			histogram_merge(&total[m], &nodes[i].latency[m]);
+}
+
+static void release_nodes()
+{
+	int i;
+
+	for (i = 0; i < config->nodes; i++)
+	{
+		scheduler_select(nodes[i].scheduler);
+		scheduler_clean_up();
+		scheduler_destroy(nodes[i].scheduler);
+		free(nodes[i].core_job);
+		free(nodes[i].quantum_end);
+		free(nodes[i].pending);
+		free(nodes[i].batch);
+		free(nodes[i].batch_cores);
+	}
+	free(nodes);
+	free(remaining);
+	free(start);
+}
+
+/*
+ * Runs jobs (count of them, in any order) on the cluster described by
+ * cluster_config and prints the latency distributions over all nodes.
+ */
+int cluster_run(const cluster_config_t *cluster_config, const cluster_job_t *cluster_jobs, int count)
+{
+	const char *dispatch_names[] = { "round-robin", "least-loaded", "power-of-two-choices" };
+	int i, m, threads = cluster_config->threads;
+	struct timespec wall_start, wall_end;
+
+	if (threads > cluster_config->nodes)
+		threads = cluster_config->nodes;
+
+	clock_gettime(CLOCK_MONOTONIC, &wall_start);
+	long long steps = simulate(cluster_config, cluster_jobs, count, threads);
+	clock_gettime(CLOCK_MONOTONIC, &wall_end);
+
+	/*
+	 * Report.
+	 */
+	histogram_t *total = malloc(NUM_METRICS * sizeof(histogram_t));
+	long long min_routed = nodes[0].routed, max_routed = nodes[0].routed;
+	scheduler_time_t makespan = 0;
+	for (m = 0; m < NUM_METRICS; m++)
+		histogram_init(&total[m]);
+	merge_latency(total);
+	for (i = 0; i < config->nodes; i++)
+	{
+		if (nodes[i].routed < min_routed)
+			min_routed = nodes[i].routed;
+		if (nodes[i].routed > max_routed)
+			max_routed = nodes[i].routed;
+		if (nodes[i].makespan > makespan)
+			makespan = nodes[i].makespan;
+	}
+
+	printf("Cluster of %d node(s) with %d core(s) each, %s dispatch, %d thread(s)\n",
+			config->nodes, config->cores, dispatch_names[config->dispatch], threads);
+	printf("Jobs: %d, makespan: %lld, %lld event times simulated in %.2f s\n", count, makespan, steps,
+			(wall_end.tv_sec - wall_start.tv_sec) + (wall_end.tv_nsec - wall_start.tv_nsec) / 1e9);
+	printf("Jobs per node min/mean/max: %lld/%.1f/%lld\n", min_routed, (double)count / config->nodes, max_routed);
+	print_latency("Waiting", &total[METRIC_WAITING]);
+	print_latency("Turnaround", &total[METRIC_TURNAROUND]);
+	print_latency("Response", &total[METRIC_RESPONSE]);
+
+	release_nodes();
+	free(total);
+
+	return 0;
+}
+
+/*
+ * Simulates jobs on the cluster described by cluster_config on the calling
+ * thread and adds the waiting, turnaround and response times of every job
+ * to latency[NUM_METRICS], which the caller has initialized.  Returns the
+ * makespan.
+ */
+scheduler_time_t cluster_predict(const cluster_config_t *cluster_config, const cluster_job_t *cluster_jobs, int count, histogram_t *latency)
+{
+	scheduler_time_t makespan = 0;
+	int i;
+
+	simulate(cluster_config, cluster_jobs, count, 1);
+	merge_latency(latency);
+	for (i = 0; i < config->nodes; i++)
+		if (nodes[i].makespan > makespan)
+			makespan = nodes[i].makespan;
+	release_nodes();
+
+	return makespan;
+}
@@ -0,0 +1,38 @@
+/** @file cluster.h
+ */
+
+#ifndef CLUSTER_H_
+#define CLUSTER_H_
+
+#include "libscheduler/libscheduler.h"
+#include "libhistogram/libhistogram.h"
+
+/*
+ * How the front-end dispatcher routes an arriving job to a node: in turn,
+ * to the node with the fewest jobs in flight, or to the less loaded of two
+ * nodes picked at random.
+ */
+typedef enum {DISPATCH_RR = 0, DISPATCH_LEAST, DISPATCH_P2C} dispatch_t;
+
+typedef struct _cluster_job_t
+{
+	scheduler_time_t arrival_time, run_time;
+	int priority;
+	scheduler_time_t deadline;
+} cluster_job_t;
+
+typedef struct _cluster_config_t
+{
+	int nodes, cores, threads;
+	scheme_t scheme;
+	const scheduler_policy_ops *policy; // overrides scheme when set
+	int quantum;                        // for RR and STRIDE, 0 otherwise
+	int latency;                        // CFS target latency
+	dispatch_t dispatch;
+	unsigned int seed;                  // for DISPATCH_P2C
+} cluster_config_t;
+
+int cluster_run(const cluster_config_t *config, const cluster_job_t *jobs, int count);
+scheduler_time_t cluster_predict(const cluster_config_t *config, const cluster_job_t *jobs, int count, histogram_t *latency);
+
+#endif /* CLUSTER_H_ */
@@ -0,0 +1,283 @@
+/** @file decisionlog.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "decisionlog.h"
+
+#define LOG_MAGIC "SDL1"
+
+
+static void write_number(FILE *file, long long value)
+{
+	// zigzag: small magnitudes of either sign take few bytes
+	unsigned long long bits = ((unsigned long long)value << 1) ^ (unsigned long long)(value >> 63);
+
+	while (bits >= 0x80)
+	{
+		fputc((int)(bits & 0x7f) | 0x80, file);
+		bits >>= 7;
+	}
+	fputc((int)bits, file);
+}
+
+/*
+ * Reads a number written by write_number(); returns 0 at the end of the file.
+ */
+static int read_number(FILE *file, long long *value)
+{
+	unsigned long long bits = 0;
+	int shift = 0, c;
+
+	do
+	{
+		c = fgetc(file);
+		if (c == EOF || shift > 63)
+			return 0;
+		bits |= (unsigned long long)(c & 0x7f) << shift;
+		shift += 7;
+	} while (c & 0x80);
+
+	*value = (long long)(bits >> 1) ^ -(long long)(bits & 1);
+	return 1;
+}
+
+static int read_int(FILE *file, int *value)
+{
+	long long number;
+
+	if (!read_number(file, &number))
+		return 0;
+	*value = (int)number;
+	return 1;
+}
+
+/*
+ * Creates the log at path and writes the configuration; returns NULL if the
+ * file cannot be created.
+ */
+decision_log_t *decision_log_create(const char *path, const decision_log_config_t *config)
+{
+	FILE *file = fopen(path, "wb");
+	int i;
+
+	if (file == NULL)
+		return NULL;
+
+	decision_log_t *log = calloc(1, sizeof(decision_log_t));
+	log->file = file;
+
+	fwrite(LOG_MAGIC, 1, 4, file);
+	write_number(file, config->cores);
+	write_number(file, config->scheme);
+	write_number(file, config->latency);
+	write_number(file, config->per_core_queues);
+	write_number(file, config->affinity_window);
+	write_number(file, config->aging_interval);
+	write_number(file, config->adaptive_latency);
+	write_number(file, config->adaptive_floor);
+	write_number(file, config->queue_limit);
+	write_number(file, config->admission);
+	write_number(file, config->core_speeds != NULL);
+	if (config->core_speeds != NULL)
+		for (i = 0; i < config->cores; i++)
+			write_number(file, config->core_speeds[i]);
+	write_number(file, config->policy_file != NULL ? strlen(config->policy_file) : 0);
+	if (config->policy_file != NULL)
+		fwrite(config->policy_file, 1, strlen(config->policy_file), file);
+
+	return log;
+}
+
+/*
+ * Records a call with up to three arguments (the ones the call takes, in
+ * the order of log_call_t) and its result.
+ */
+void decision_log_call(decision_log_t *log, log_call_t call, long long arg0, long long arg1, long long arg2, long long result)
+{
+	write_number(log->file, call);
+	switch (call)
+	{
+		case LOG_JOB_FINISHED:
+		case LOG_JOB_BLOCKED:
+		case LOG_JOB_UNBLOCKED:
+			write_number(log->file, arg0);
+			write_number(log->file, arg1);
+			write_number(log->file, arg2);
+			break;
+
+		case LOG_QUANTUM_EXPIRED:
+		case LOG_CORE_STALLED:
+			write_number(log->file, arg0);
+			write_number(log->file, arg1);
+			break;
+
+		case LOG_TIME_SLICE:
+			write_number(log->file, arg0);
+			break;
+
+		default:
+			break;
+	}
+	write_number(log->file, result);
+	log->records++;
+}
+
+void decision_log_new_jobs(decision_log_t *log, scheduler_time_t time, const scheduler_arrival_t *arrivals, int count, const int *cores)
+{
+	int i;
+
+	write_number(log->file, LOG_NEW_JOBS);
+	write_number(log->file, time);
+	write_number(log->file, count);
+	for (i = 0; i < count; i++)
+	{
+		write_number(log->file, arrivals[i].job_number);
+		write_number(log->file, arrivals[i].running_time);
+		write_number(log->file, arrivals[i].priority);
+		write_number(log->file, arrivals[i].deadline);
+		write_number(log->file, cores[i]);
+	}
+	log->records++;
+}
+
+/*
+ * Opens a log for reading and fills config from it; returns NULL if the
+ * file cannot be read or is not a decision log.
+ */
+decision_log_t *decision_log_open(const char *path, decision_log_config_t *config)
+{
+	FILE *file = fopen(path, "rb");
+	char magic[4];
+	int i = 0, has_speeds, length;
+
+	if (file == NULL)
+		return NULL;
+
+	memset(config, 0, sizeof(decision_log_config_t));
+	if (fread(magic, 1, 4, file) != 4 || memcmp(magic, LOG_MAGIC, 4) != 0 ||
+			!read_int(file, &config->cores) || !read_int(file, &config->scheme) ||
+			!read_int(file, &config->latency) || !read_int(file, &config->per_core_queues) ||
+			!read_int(file, &config->affinity_window) || !read_int(file, &config->aging_interval) ||
+			!read_int(file, &config->adaptive_latency) || !read_int(file, &config->adaptive_floor) ||
+			!read_int(file, &config->queue_limit) || !read_int(file, &config->admission) ||
+			!read_int(file, &has_speeds) || config->cores <= 0)
+	{
+		fclose(file);
+		return NULL;
+	}
+
+	if (has_speeds)
+	{
+		config->core_speeds = malloc(config->cores * sizeof(int));
+		for (i = 0; i < config->cores; i++)
+			if (!read_int(file, &config->core_speeds[i]))
+				break;
+	}
+	if (!read_int(file, &length) || length < 0 || (has_speeds && i < config->cores))
+	{
+		decision_log_free_config(config);
+		fclose(file);
+		return NULL;
+	}
+	if (length > 0)
+	{
+		config->policy_file = calloc(length + 1, 1);
+		if (fread(config->policy_file, 1, length, file) != (size_t)length)
+		{
+			decision_log_free_config(config);
+			fclose(file);
+			return NULL;
+		}
+	}
+
+	decision_log_t *log = calloc(1, sizeof(decision_log_t));
+	log->file = file;
+	return log;
+}
+
+/*
+ * Reads the next record.  The record and its arrays are reused by the next
+ * call.  Returns NULL at the end of the log, with log->truncated set if it
+ * ended in the middle of a record.
+ */
+log_record_t *decision_log_read(decision_log_t *log)
+{
+	log_record_t *record = &log->record;
+	int call, i, ok = 1;
+
+	if (!read_int(log->file, &call))
+		return NULL;
+
+	record->call = call;
+	record->count = 0;
+	switch (call)
+	{
+		case LOG_NEW_JOBS:
+			ok = read_number(log->file, &record->args[0]) && read_int(log->file, &record->count) && record->count >= 0;
+			if (ok && record->count > log->capacity)
+			{
+				log->capacity = record->count;
+				record->arrivals = realloc(record->arrivals, log->capacity * sizeof(scheduler_arrival_t));
+				record->cores = realloc(record->cores, log->capacity * sizeof(int));
+			}
+			for (i = 0; ok && i < record->count; i++)
+				ok = read_number(log->file, &record->arrivals[i].job_number) &&
+						read_number(log->file, &record->arrivals[i].running_time) &&
+						read_int(log->file, &record->arrivals[i].priority) &&
+						read_number(log->file, &record->arrivals[i].deadline) &&
+						read_int(log->file, &record->cores[i]);
+			break;
+
+		case LOG_JOB_FINISHED:
+		case LOG_JOB_BLOCKED:
+		case LOG_JOB_UNBLOCKED:
+			ok = read_number(log->file, &record->args[0]) && read_number(log->file, &record->args[1]) &&
+					read_number(log->file, &record->args[2]) && read_number(log->file, &record->result);
+			break;
+
+		case LOG_QUANTUM_EXPIRED:
+		case LOG_CORE_STALLED:
+			ok = read_number(log->file, &record->args[0]) && read_number(log->file, &record->args[1]) &&
+					read_number(log->file, &record->result);
+			break;
+
+		case LOG_TIME_SLICE:
+			ok = read_number(log->file, &record->args[0]) && read_number(log->file, &record->result);
+			break;
+
+		case LOG_SHED_JOB:
+			ok = read_number(log->file, &record->result);
+			break;
+
+		default:
+			ok = 0;
+			break;
+	}
+
+	if (!ok)
+	{
+		log->truncated = 1;
+		return NULL;
+	}
+	log->records++;
+	return record;
+}
+
+void decision_log_close(decision_log_t *log)
+{
+	fclose(log->file);
+	free(log->record.arrivals);
+	free(log->record.cores);
+	free(log);
+}
+
+void decision_log_free_config(decision_log_config_t *config)
+{
+	free(config->core_speeds);
+	free(config->policy_file);
+	config->core_speeds = NULL;
+	config->policy_file = NULL;
+}
@@ -0,0 +1,77 @@
+/** @file decisionlog.h
+ */
+
+#ifndef DECISIONLOG_H_
+#define DECISIONLOG_H_
+
+#include <stdio.h>
+
+#include "libscheduler/libscheduler.h"
+
+/*
+ * A decision log records every scheduler call the simulator makes that
+ * decides or reports something about the schedule, with its arguments and
+ * its result, so that replay can make the same calls against another build
+ * of the library and check that it decides the same.  The file starts with
+ * the scheduler configuration and holds one record per call; every number
+ * is a zigzag-encoded variable-length integer, so most records take a few
+ * bytes.
+ */
+
+typedef enum
+{
+	LOG_NEW_JOBS = 1,       // time, count, then per arrival: job, running time, priority, deadline, result
+	LOG_JOB_FINISHED,       // core, job, time, result
+	LOG_JOB_BLOCKED,        // core, job, time, result
+	LOG_JOB_UNBLOCKED,      // job, time, running time, result
+	LOG_QUANTUM_EXPIRED,    // core, time, result
+	LOG_TIME_SLICE,         // core, result
+	LOG_SHED_JOB,           // result
+	LOG_CORE_STALLED        // core, time units, result (0)
+} log_call_t;
+
+/*
+ * Everything the simulator passed to scheduler_start_up*() and the
+ * scheduler_set_*() calls.  Fields left at 0 (-1 for queue_limit) were not
+ * set; scheme is -1 when policy_file names the policy.
+ */
+typedef struct _decision_log_config_t
+{
+	int cores, scheme, latency;
+	int per_core_queues, affinity_window, aging_interval;
+	int adaptive_latency, adaptive_floor;
+	int queue_limit, admission;
+	int *core_speeds;             // cores of them, or NULL
+	char *policy_file;            // or NULL
+} decision_log_config_t;
+
+typedef struct _log_record_t
+{
+	log_call_t call;
+	long long args[3];
+	long long result;
+	int count;                    // LOG_NEW_JOBS only
+	scheduler_arrival_t *arrivals;
+	int *cores;
+} log_record_t;
+
+typedef struct _decision_log_t
+{
+	FILE *file;
+	long long records;
+	int truncated;                // the file ended in the middle of a record
+	int capacity;                 // of the record buffers when reading
+	log_record_t record;
+} decision_log_t;
+
+decision_log_t *decision_log_create(const char *path, const decision_log_config_t *config);
+void decision_log_call(decision_log_t *log, log_call_t call, long long arg0, long long arg1, long long arg2, long long result);
+void decision_log_new_jobs(decision_log_t *log, scheduler_time_t time, const scheduler_arrival_t *arrivals, int count, const int *cores);
+
+decision_log_t *decision_log_open(const char *path, decision_log_config_t *config);
+log_record_t *decision_log_read(decision_log_t *log);
+
+void decision_log_close(decision_log_t *log);
+void decision_log_free_config(decision_log_config_t *config);
+
+#endif /* DECISIONLOG_H_ */
@@ -0,0 +1,437 @@
+/** @file executor.c
+ */
+
+/*
+ * Executor: runs a trace on real threads instead of simulating it.  Each
+ * core is a worker thread pinned to a CPU that spins for as much CPU time as
+ * the job the scheduler put on it has running time, a time unit being
+ * tick_us microseconds.  Spinning by the thread's CPU clock rather than by
+ * a loop count calibrated up front keeps the jobs the right length when the
+ * clock frequency changes or a CPU is shared.  The main thread is the timer:
+ * it sleeps until the next arrival or quantum expiry and makes those
+ * scheduler calls, while a worker makes the scheduler_job_finished() call
+ * of its own job.  Every scheduler call is made under one lock, so the
+ * library runs unchanged.  The measured latencies are printed next to the
+ * ones the event-driven simulation of cluster.c predicts for the trace.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#include "executor.h"
+#include "libhistogram/libhistogram.h"
+
+
+typedef struct _core_t
+{
+	pthread_t thread;
+	int core_id, cpu;
+	int job;                       // job the core is to run, -1 when idle
+	scheduler_time_t quantum_end;  // time the quantum expires, -1 for none
+	pthread_cond_t wake;
+} core_t;
+
+/*
+ * The scheduler calls whose cost is measured.
+ */
+enum { CALL_NEW_JOBS = 0, CALL_JOB_FINISHED, CALL_QUANTUM_EXPIRED, NUM_CALLS };
+
+typedef struct _call_cost_t
+{
+	long long count, ns;
+} call_cost_t;
+
+static const executor_config_t *config;
+static const cluster_job_t *jobs;
+static scheduler_t *scheduler;
+static core_t *cores;
+static long long *remaining;    // nanoseconds of CPU time left of each job
+static long long *start_ns, *finish_ns;
+static long long tick_ns;
+static int finished, stop, time_sliced;
+static struct timespec epoch;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t timer;
+static call_cost_t call_cost[NUM_CALLS];
+static long long lock_count, lock_wait_ns;
+
+
+static long long now_ns()
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - epoch.tv_sec) * 1000000000LL + (now.tv_nsec - epoch.tv_nsec);
+}
+
+static scheduler_time_t now_time()
+{
+	return now_ns() / tick_ns;
+}
+
+/*
+ * Takes the lock, adding the time spent waiting for it to lock_wait_ns.
+ */
+static void acquire()
+{
+	long long before = now_ns();
+
+	pthread_mutex_lock(&lock);
+	lock_wait_ns += now_ns() - before;
+	lock_count++;
+}
+
+static void charge(int call, long long before)
+{
+	call_cost[call].count++;
+	call_cost[call].ns += now_ns() - before;
+}
+
+/*
+ * Burns up to ns nanoseconds of the calling thread's CPU time; returns how
+ * many it did burn.
+ */
+static long long spin(long long ns)
+{
+	struct timespec before, now;
+	long long used;
+	int i;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &before);
+	do
+	{
+		for (i = 0; i < 256; i++)
+			__asm__ __volatile__("" ::: "memory");
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+		used = (now.tv_sec - before.tv_sec) * 1000000000LL + (now.tv_nsec - before.tv_nsec);
+	} while (used < ns);
+
+	return used;
+}
+
+static scheduler_time_t core_quantum(int core_id)
+{
+	if (config->policy == NULL && config->scheme == CFS)
+		return scheduler_time_slice(core_id);
+
+	return config->quantum;
+}
+
+/*
+ * Puts job (or nothing, for -1) on a core and wakes its worker; called with
+ * the lock held.
+ */
+static void run_on_core(int core_id, int job, scheduler_time_t time)
+{
+	core_t *core = &cores[core_id];
+
+	__atomic_store_n(&core->job, job, __ATOMIC_RELEASE);
+	core->quantum_end = -1;
+	if (job == -1)
+		return;
+
+	if (start_ns[job] == -1)
+		start_ns[job] = now_ns();
+	if (time_sliced)
+		core->quantum_end = time + core_quantum(core_id);
+	pthread_cond_signal(&core->wake);
+}
+
+/*
+ * A worker: spins for its job in chunks of 50 microseconds, checking
+ * in between whether the scheduler moved the job away.  A job preempted in
+ * the middle of a chunk may run on its next core while its last core ends
+ * that chunk, hence the atomic updates of remaining[].
+ */
+static void *core_main(void *arg)
+{
+	core_t *core = (core_t *)arg;
+	cpu_set_t cpus;
+
+	CPU_ZERO(&cpus);
+	CPU_SET(core->cpu, &cpus);
+	pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+	scheduler_select(scheduler);
+
+	acquire();
+	while (!stop)
+	{
+		int job = core->job;
+		if (job == -1)
+		{
+			pthread_cond_wait(&core->wake, &lock);
+			continue;
+		}
+		pthread_mutex_unlock(&lock);
+
+		while (__atomic_load_n(&core->job, __ATOMIC_ACQUIRE) == job)
+		{
+			long long left = __atomic_load_n(&remaining[job], __ATOMIC_RELAXED);
+			if (left <= 0)
+				break;
+			__atomic_sub_fetch(&remaining[job], spin(left < 50000 ? left : 50000), __ATOMIC_RELAXED);
+		}
+
+		acquire();
+		if (core->job == job && __atomic_load_n(&remaining[job], __ATOMIC_RELAXED) <= 0)
+		{
+			scheduler_time_t time = now_time();
+			long long before = now_ns();
+
+			finish_ns[job] = before;
+			finished++;
+			int next = scheduler_job_finished(core->core_id, job, time);
+			charge(CALL_JOB_FINISHED, before);
+			run_on_core(core->core_id, next, time);
+			pthread_cond_signal(&timer);
+		}
+	}
+	pthread_mutex_unlock(&lock);
+
+	return NULL;
+}
+
+static int compare_arrivals(const void *a, const void *b)
+{
+	int job_a = *(const int *)a, job_b = *(const int *)b;
+
+	if (jobs[job_a].arrival_time != jobs[job_b].arrival_time)
+		return (jobs[job_a].arrival_time > jobs[job_b].arrival_time) - (jobs[job_a].arrival_time < jobs[job_b].arrival_time);
+	return job_a - job_b;
+}
+
+/*
+ * The timer: releases the jobs at their arrival times and expires quanta,
+ * sleeping in between, until every job has finished.
+ */
+static void dispatch(const int *order, int count)
+{
+	scheduler_arrival_t *batch = malloc(count * sizeof(scheduler_arrival_t));
+	int *batch_cores = malloc(count * sizeof(int));
+	int i, next_arrival = 0;
+
+	acquire();
+	while (finished < count)
+	{
+		scheduler_time_t time = now_time();
+		int arrivals = 0;
+
+		for (i = 0; i < config->cores; i++)
+			if (cores[i].job != -1 && cores[i].quantum_end != -1 && cores[i].quantum_end <= time)
+			{
+				long long before = now_ns();
+				int next = scheduler_quantum_expired(i, time);
+				charge(CALL_QUANTUM_EXPIRED, before);
+				run_on_core(i, next, time);
+			}
+
+		while (next_arrival + arrivals < count && jobs[order[next_arrival + arrivals]].arrival_time <= time)
+		{
+			const cluster_job_t *job = &jobs[order[next_arrival + arrivals]];
+			batch[arrivals].job_number = order[next_arrival + arrivals];
+			batch[arrivals].running_time = job->run_time;
+			batch[arrivals].priority = job->priority;
+			batch[arrivals].deadline = job->deadline;
+			arrivals++;
+		}
+		if (arrivals > 0)
+		{
+			long long before = now_ns();
+			scheduler_new_jobs(time, batch, arrivals, batch_cores);
+			charge(CALL_NEW_JOBS, before);
+			for (i = 0; i < arrivals; i++)
+				if (batch_cores[i] >= 0)
+					run_on_core(batch_cores[i], batch[i].job_number, time);
+			next_arrival += arrivals;
+		}
+
+		scheduler_time_t wake = LLONG_MAX;
+		if (next_arrival < count)
+			wake = jobs[order[next_arrival]].arrival_time;
+		for (i = 0; i < config->cores; i++)
+			if (cores[i].job != -1 && cores[i].quantum_end != -1 && cores[i].quantum_end < wake)
+				wake = cores[i].quantum_end;
+
+		if (wake == LLONG_MAX)
+			pthread_cond_wait(&timer, &lock);
+		else if (wake > time)
+		{
+			long long at = wake * tick_ns;
+			struct timespec deadline = { epoch.tv_sec + at / 1000000000LL, epoch.tv_nsec + at % 1000000000LL };
+			if (deadline.tv_nsec >= 1000000000L)
+			{
+				deadline.tv_sec++;
+				deadline.tv_nsec -= 1000000000L;
+			}
+			pthread_cond_timedwait(&timer, &lock, &deadline);
+		}
+	}
+
+	stop = 1;
+	for (i = 0; i < config->cores; i++)
+		pthread_cond_signal(&cores[i].wake);
+	pthread_mutex_unlock(&lock);
+
+	free(batch);
+	free(batch_cores);
+}
+
+static void print_comparison(const char *name, histogram_t *measured, histogram_t *predicted)
+{
+	double unit = config->tick_us;
+
+	printf("  %-11s measured  mean %9.2f  p50 %7.1f  p90 %7.1f  p99 %7.1f  max %7.1f\n", name,
+			histogram_mean(measured) / unit, histogram_percentile(measured, 50) / unit,
+			histogram_percentile(measured, 90) / unit, histogram_percentile(measured, 99) / unit,
+			histogram_percentile(measured, 100) / unit);
+	printf("  %-11s predicted mean %9.2f  p50 %7.1f  p90 %7.1f  p99 %7.1f  max %7.1f\n", "",
+			histogram_mean(predicted), (double)histogram_percentile(predicted, 50),
+			(double)histogram_percentile(predicted, 90), (double)histogram_percentile(predicted, 99),
+			(double)histogram_percentile(predicted, 100));
+}
+
+static void print_call_cost(const char *name, call_cost_t *cost)
+{
+	printf("  %-16s %8lld calls, mean %8.0f ns\n", name, cost->count,
+			cost->count > 0 ? (double)cost->ns / cost->count : 0.0);
+}
+
+/*
+ * Runs jobs (count of them, in any order) on config->cores pinned threads
+ * and prints the measured latency distributions, in time units, next to the
+ * predicted ones, then the cost of the scheduler calls.
+ */
+int executor_run(const executor_config_t *executor_config, const cluster_job_t *executor_jobs, int count)
+{
+	histogram_t *measured = malloc(NUM_METRICS * sizeof(histogram_t));
+	histogram_t *predicted = malloc(NUM_METRICS * sizeof(histogram_t));
+	pthread_condattr_t timer_attr;
+	cpu_set_t allowed;
+	int i, m, cpus = 0;
+
+	config = executor_config;
+	jobs = executor_jobs;
+	time_sliced = (config->quantum > 0 || (config->policy == NULL && config->scheme == CFS));
+	tick_ns = config->tick_us * 1000LL;
+
+	/*
+	 * The prediction: the same trace on a simulated node of as many cores.
+	 */
+	cluster_config_t node = { 1, config->cores, 1, config->scheme, config->policy, config->quantum, config->latency, DISPATCH_RR, 1 };
+	for (m = 0; m < NUM_METRICS; m++)
+	{
+		histogram_init(&measured[m]);
+		histogram_init(&predicted[m]);
+	}
+	scheduler_time_t predicted_makespan = cluster_predict(&node, jobs, count, predicted);
+
+	/*
+	 * Workers take the allowed CPUs in turn, sharing them when there are
+	 * more cores than CPUs.
+	 */
+	int *cpu_list = malloc(CPU_SETSIZE * sizeof(int));
+	sched_getaffinity(0, sizeof(allowed), &allowed);
+	for (i = 0; i < CPU_SETSIZE; i++)
+		if (CPU_ISSET(i, &allowed))
+			cpu_list[cpus++] = i;
+
+	int *order = malloc(count * sizeof(int));
+	remaining = malloc(count * sizeof(long long));
+	start_ns = malloc(count * sizeof(long long));
+	finish_ns = malloc(count * sizeof(long long));
+	for (i = 0; i < count; i++)
+	{
+		order[i] = i;
+		remaining[i] = jobs[i].run_time * tick_ns;
+		start_ns[i] = -1;
+	}
+	qsort(order, count, sizeof(int), compare_arrivals);
+
+	scheduler = scheduler_create();
+	scheduler_select(scheduler);
+	if (config->policy != NULL)
+		scheduler_start_up_policy(config->cores, config->policy);
+	else
+		scheduler_start_up(config->cores, config->scheme);
+	if (config->policy == NULL && config->scheme == CFS)
+		scheduler_set_target_latency(config->latency);
+
+	pthread_condattr_init(&timer_attr);
+	pthread_condattr_setclock(&timer_attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&timer, &timer_attr);
+	pthread_condattr_destroy(&timer_attr);
+
+	finished = 0;
+	stop = 0;
+	cores = malloc(config->cores * sizeof(core_t));
+	for (i = 0; i < config->cores; i++)
+	{
+		cores[i].core_id = i;
+		cores[i].cpu = cpu_list[i % cpus];
+		cores[i].job = -1;
+		cores[i].quantum_end = -1;
+		pthread_cond_init(&cores[i].wake, NULL);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &epoch);
+	for (i = 0; i < config->cores; i++)
+		pthread_create(&cores[i].thread, NULL, core_main, &cores[i]);
+	dispatch(order, count);
+	for (i = 0; i < config->cores; i++)
+		pthread_join(cores[i].thread, NULL);
+	long long wall_ns = now_ns();
+
+	/*
+	 * Report, in time units.
+	 */
+	long long makespan_ns = 0;
+	for (i = 0; i < count; i++)
+	{
+		long long arrival = jobs[i].arrival_time * tick_ns;
+		long long turnaround = finish_ns[i] - arrival;
+		long long waiting = turnaround - jobs[i].run_time * tick_ns;
+
+		histogram_record(&measured[METRIC_WAITING], waiting > 0 ? waiting / 1000 : 0);
+		histogram_record(&measured[METRIC_TURNAROUND], turnaround / 1000);
+		histogram_record(&measured[METRIC_RESPONSE], start_ns[i] > arrival ? (start_ns[i] - arrival) / 1000 : 0);
+		if (finish_ns[i] > makespan_ns)
+			makespan_ns = finish_ns[i];
+	}
+
+	printf("Executor with %d worker thread(s) on %d CPU(s), %d us per time unit\n",
+			config->cores, cpus < config->cores ? cpus : config->cores, config->tick_us);
+	printf("Jobs: %d, makespan: %.1f measured, %lld predicted, wall time %.2f s\n", count,
+			(double)makespan_ns / tick_ns, predicted_makespan, wall_ns / 1e9);
+	print_comparison("Waiting", &measured[METRIC_WAITING], &predicted[METRIC_WAITING]);
+	print_comparison("Turnaround", &measured[METRIC_TURNAROUND], &predicted[METRIC_TURNAROUND]);
+	print_comparison("Response", &measured[METRIC_RESPONSE], &predicted[METRIC_RESPONSE]);
+	printf("Scheduler call cost:\n");
+	print_call_cost("new_jobs", &call_cost[CALL_NEW_JOBS]);
+	print_call_cost("job_finished", &call_cost[CALL_JOB_FINISHED]);
+	print_call_cost("quantum_expired", &call_cost[CALL_QUANTUM_EXPIRED]);
+	printf("  %-16s %8lld times, mean wait %5.0f ns\n", "lock acquired", lock_count,
+			lock_count > 0 ? (double)lock_wait_ns / lock_count : 0.0);
+
+	scheduler_clean_up();
+	scheduler_destroy(scheduler);
+	for (i = 0; i < config->cores; i++)
+		pthread_cond_destroy(&cores[i].wake);
+	pthread_cond_destroy(&timer);
+	free(cores);
+	free(cpu_list);
+	free(order);
+	free(remaining);
+	free(start_ns);
+	free(finish_ns);
+	free(measured);
+	free(predicted);
+
+	return 0;
+}
@@ -0,0 +1,21 @@
+/** @file executor.h
+ */
+
+#ifndef EXECUTOR_H_
+#define EXECUTOR_H_
+
+#include "cluster.h"
+
+typedef struct _executor_config_t
+{
+	int cores;
+	scheme_t scheme;
+	const scheduler_policy_ops *policy; // overrides scheme when set
+	int quantum;                        // for RR and STRIDE, 0 otherwise
+	int latency;                        // CFS target latency
+	int tick_us;                        // wall-clock microseconds per time unit
+} executor_config_t;
+
+int executor_run(const executor_config_t *config, const cluster_job_t *jobs, int count);
+
+#endif /* EXECUTOR_H_ */
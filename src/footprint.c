@@ -0,0 +1,75 @@
+/** @file footprint.c
+ */
+
+/*
+ * Memory footprint benchmark: queues a backlog of jobs on a single core
+ * under a scheme of each ready queue kind and reports the heap bytes each
+ * queued job costs, as malloc accounts for them, next to the sizes of the
+ * structures behind them.  The job itself is the same under every scheme;
+ * the difference between the kinds is the queue's own node or slot.
+ *
+ * Usage: footprint [<jobs>]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <malloc.h>
+
+#include "libscheduler/libscheduler.h"
+
+static size_t heap_in_use(void)
+{
+	return mallinfo2().uordblks;
+}
+
+/*
+ * Returns the heap bytes per job of a backlog of count jobs under scheme.
+ */
+static double bytes_per_job(scheme_t scheme, int count)
+{
+	scheduler_t *scheduler = scheduler_create();
+	scheduler_id_t running = 1;
+	int i;
+
+	scheduler_select(scheduler);
+	scheduler_start_up(1, scheme);
+
+	// Grow the scheduler's own buffers before measuring
+	scheduler_new_job(0, 0, 1, 0);
+	scheduler_job_finished(0, 0, 1);
+
+	size_t before = heap_in_use();
+	for (i = 1; i <= count; i++)
+		scheduler_new_job(i, 1, 1 + i % 97, i % 5);
+	size_t after = heap_in_use();
+
+	while (running != -1)
+		running = scheduler_job_finished(0, running, 2);
+	scheduler_clean_up();
+	scheduler_destroy(scheduler);
+
+	return (double)(after - before) / count;
+}
+
+int main(int argc, char **argv)
+{
+	const struct { scheme_t scheme; const char *queue; } kinds[] = {
+		{ FCFS, "list (fcfs)" }, { CFS, "tree (cfs)" }, { STRIDE, "heap (stride)" } };
+	int count = (argc > 1) ? atoi(argv[1]) : 10000;
+	int i;
+
+	if (count <= 0)
+	{
+		fprintf(stderr, "Usage: %s [<jobs>]\n", argv[0]);
+		return 1;
+	}
+
+	printf("sizeof(scheduler_time_t) = %zu, sizeof(scheduler_job_t) = %zu, sizeof(scheduler_arrival_t) = %zu\n",
+			sizeof(scheduler_time_t), sizeof(scheduler_job_t), sizeof(scheduler_arrival_t));
+	printf("%d queued jobs on one core\n", count);
+	printf("Queue          heap bytes/job\n");
+	for (i = 0; i < 3; i++)
+		printf("%-13s  %14.1f\n", kinds[i].queue, bytes_per_job(kinds[i].scheme, count));
+
+	return 0;
+}
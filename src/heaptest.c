@@ -0,0 +1,77 @@
+/** @file heaptest.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "libheap/libheap.h"
+
+int compare1(const void * a, const void * b)
+{
+	return ( *(int*)a - *(int*)b );
+}
+
+int main()
+{
+	heap_t h;
+
+	heap_init(&h, compare1);
+
+	/* Pupulate some data... */
+	int *values = malloc(1000 * sizeof(int));
+
+	int i;
+	for (i = 0; i < 1000; i++)
+		values[i] = i;
+
+	heap_push(&h, &values[14]);
+	heap_push(&h, &values[12]);
+	heap_push(&h, &values[13]);
+	heap_push(&h, &values[12]);
+	printf("Total elements: %d (expected 4).\n", heap_size(&h));
+	printf("Min element: %d (expected 12).\n", *((int *)heap_peek(&h)));
+
+	int val = *((int *)heap_poll(&h));
+	printf("Polled element: %d (expected 12).\n", val);
+	val = *((int *)heap_poll(&h));
+	printf("Polled element: %d (expected 12).\n", val);
+	printf("Min element: %d (expected 13).\n", *((int *)heap_peek(&h)));
+
+	/* Scrambled inserts drain in order. */
+	for (i = 0; i < 1000; i++)
+		heap_push(&h, &values[(i * 7919) % 1000]);
+	printf("Total elements: %d (expected 1002).\n", heap_size(&h));
+
+	int last = -1, sorted = 1;
+	while (heap_size(&h) > 0)
+	{
+		val = *((int *)heap_poll(&h));
+		if (val < last)
+			sorted = 0;
+		last = val;
+	}
+	printf("Drained in order: %d (expected 1).\n", sorted);
+
+	/* Removing from the middle keeps the heap order. */
+	for (i = 0; i < 100; i++)
+		heap_push(&h, &values[(i * 37) % 100]);
+	int removed = heap_remove(&h, &values[0]) + heap_remove(&h, &values[50]) + heap_remove(&h, &values[99]);
+	printf("Removed: %d (expected 3).\n", removed);
+	printf("Remove missing: %d (expected 0).\n", heap_remove(&h, &values[50]));
+	last = -1, sorted = 1;
+	while (heap_size(&h) > 0)
+	{
+		val = *((int *)heap_poll(&h));
+		if (val < last || val == 0 || val == 50 || val == 99)
+			sorted = 0;
+		last = val;
+	}
+	printf("Drained in order after removals: %d (expected 1).\n", sorted);
+	printf("Poll on empty: %p (expected (nil)).\n", heap_poll(&h));
+
+	heap_destroy(&h);
+
+	free(values);
+
+	return 0;
+}
@@ -0,0 +1,51 @@
+/** @file histtest.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "libhistogram/libhistogram.h"
+
+int main()
+{
+	histogram_t *h = malloc(sizeof(histogram_t));
+	unsigned long long i;
+
+	histogram_init(h);
+	printf("Empty p50: %llu (expected 0).\n", histogram_percentile(h, 50));
+
+	/* Small values are exact. */
+	for (i = 1; i <= 10; i++)
+		histogram_record(h, i);
+	printf("Total values: %llu (expected 10).\n", histogram_count(h));
+	printf("p50/p90/max: %llu/%llu/%llu (expected 5/9/10).\n",
+			histogram_percentile(h, 50), histogram_percentile(h, 90), histogram_percentile(h, 100));
+	printf("Mean: %.2f (expected 5.50).\n", histogram_mean(h));
+
+	/* Large values are within a bucket (1/16) of the truth. */
+	histogram_init(h);
+	for (i = 1; i <= 1000000; i++)
+		histogram_record(h, i);
+	unsigned long long p99 = histogram_percentile(h, 99);
+	printf("p99 within 1/16 of 990000: %d (expected 1).\n", p99 >= 990000 && p99 <= 990000 + 990000 / 16);
+	printf("Max: %llu (expected 1000000).\n", histogram_percentile(h, 100));
+	printf("Mean: %.1f (expected 500000.5).\n", histogram_mean(h));
+
+	histogram_record(h, 18446744073709551615ULL);
+	printf("Max: %llu (expected 18446744073709551615).\n", histogram_percentile(h, 100));
+
+	/* Merging gives the same distribution as recording in one histogram. */
+	histogram_t *odd = malloc(sizeof(histogram_t));
+	histogram_init(h);
+	histogram_init(odd);
+	for (i = 1; i <= 10; i++)
+		histogram_record((i % 2) ? odd : h, i);
+	histogram_merge(h, odd);
+	printf("Merged total/p50/min/max: %llu/%llu/%llu/%llu (expected 10/5/1/10).\n",
+			histogram_count(h), histogram_percentile(h, 50), histogram_percentile(h, 0), histogram_percentile(h, 100));
+
+	free(odd);
+	free(h);
+
+	return 0;
+}
@@ -0,0 +1,313 @@
+/** @file libcalqueue.c
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "libcalqueue.h"
+
+#define MIN_BUCKETS 2
+#define WIDTH_SAMPLE 25
+
+
+/*
+  Points the dequeue scan at the bucket of key, which no key in the queue is
+  smaller than.
+*/
+static void start_at(calqueue_t *q, long long key)
+{
+  long long slot = key / q->width;
+  q->last_key = key;
+  q->last_bucket = slot & (q->num_buckets - 1);
+  q->bucket_top = (slot + 1) * q->width;
+}
+
+
+/*
+  Links node into its bucket, after the nodes with an equal key, or before
+  them with before_equal set.
+*/
+static void insert_node(calqueue_t *q, calqueue_node_t *node, int before_equal)
+{
+  calqueue_bucket_t *bucket = &q->buckets[(node->key / q->width) & (q->num_buckets - 1)];
+  node->next = NULL;
+
+  //Keys mostly come in increasing order, and ties are common with integer times
+  if (bucket->tail == NULL){
+    bucket->head = bucket->tail = node;
+    return;
+  }
+  if (bucket->tail->key < node->key || (!before_equal && bucket->tail->key == node->key)){
+    bucket->tail->next = node;
+    bucket->tail = node;
+    return;
+  }
+
+  calqueue_node_t **link = &bucket->head;
+  while ((*link)->key < node->key || (!before_equal && (*link)->key == node->key)){
+    link = &(*link)->next;
+  }
+  node->next = *link;
+  *link = node;
+}
+
+
+/*
+  Returns the bucket of the node with the smallest key, at its head, moving
+  the scan up to it. The queue must not be empty.
+*/
+static calqueue_bucket_t *find_min(calqueue_t *q)
+{
+  int mask = q->num_buckets - 1;
+  int index = q->last_bucket, i;
+  long long top = q->bucket_top;
+
+  for (i = 0; i < q->num_buckets; i++){
+    calqueue_node_t *head = q->buckets[index].head;
+    if (head != NULL && head->key < top){
+      q->last_bucket = index;
+      q->bucket_top = top;
+      q->last_key = head->key;
+      return &q->buckets[index];
+    }
+    index = (index + 1) & mask;
+    top += q->width;
+  }
+
+  //Nothing within a year of the last key: jump to the smallest head
+  int best = -1;
+  for (i = 0; i < q->num_buckets; i++){
+    if (q->buckets[i].head != NULL && (best == -1 || q->buckets[i].head->key < q->buckets[best].head->key)){
+      best = i;
+    }
+  }
+  start_at(q, q->buckets[best].head->key);
+  return &q->buckets[best];
+}
+
+
+static calqueue_node_t *unlink_min(calqueue_t *q)
+{
+  calqueue_bucket_t *bucket = find_min(q);
+  calqueue_node_t *node = bucket->head;
+  bucket->head = node->next;
+  if (bucket->head == NULL){
+    bucket->tail = NULL;
+  }
+  return node;
+}
+
+
+/*
+  Estimates the bucket width from the spacing of the earliest keys: three
+  times their mean gap, leaving out gaps over twice the mean so that a few
+  stragglers do not widen every bucket.
+*/
+static long long sample_width(calqueue_t *q)
+{
+  calqueue_node_t *sample[WIDTH_SAMPLE];
+  int count = (q->size < WIDTH_SAMPLE) ? q->size : WIDTH_SAMPLE;
+  int i, gaps = 0;
+  long long kept = 0;
+
+  if (count < 2){
+    return q->width;
+  }
+
+  for (i = 0; i < count; i++){
+    sample[i] = unlink_min(q);
+  }
+  double mean = (double)(sample[count - 1]->key - sample[0]->key) / (count - 1);
+  for (i = 1; i < count; i++){
+    long long gap = sample[i]->key - sample[i - 1]->key;
+    if (gap <= 2 * mean){
+      kept += gap;
+      gaps++;
+    }
+  }
+
+  //Put the sample back in reverse, each before its equals, to keep their order
+  for (i = count - 1; i >= 0; i--){
+    insert_node(q, sample[i], 1);
+  }
+  start_at(q, sample[0]->key);
+
+  long long width = 3 * kept / gaps;
+  return (width > 0) ? width : 1;
+}
+
+
+static void resize(calqueue_t *q, int num_buckets)
+{
+  long long width = sample_width(q);
+  calqueue_bucket_t *old = q->buckets;
+  int old_count = q->num_buckets, i;
+
+  q->buckets = calloc(num_buckets, sizeof(calqueue_bucket_t));
+  q->num_buckets = num_buckets;
+  q->width = width;
+  for (i = 0; i < old_count; i++){
+    calqueue_node_t *node = old[i].head;
+    while (node != NULL){
+      calqueue_node_t *next = node->next;
+      insert_node(q, node, 0);
+      node = next;
+    }
+  }
+  free(old);
+  start_at(q, q->last_key);
+}
+
+
+/**
+  Initializes the calqueue_t data structure.
+
+  @param q a pointer to an instance of the calqueue_t data structure
+  @param key a function pointer that returns the time of an element, which
+         must not be negative
+ */
+void calqueue_init(calqueue_t *q, long long (*key)(const void *))
+{
+  q->buckets = calloc(MIN_BUCKETS, sizeof(calqueue_bucket_t));
+  q->num_buckets = MIN_BUCKETS;
+  q->width = 1;
+  q->size = 0;
+  q->free_nodes = NULL;
+  q->key = key;
+  start_at(q, 0);
+}
+
+
+/**
+  Inserts the specified element into the queue in O(1) on average. An
+  element may be earlier than the last one dequeued.
+
+  @param q a pointer to an instance of the calqueue_t data structure
+  @param ptr a pointer to the data to be inserted
+ */
+void calqueue_push(calqueue_t *q, void *ptr)
+{
+  calqueue_node_t *node = q->free_nodes;
+  if (node != NULL){
+    q->free_nodes = node->next;
+  }
+  else{
+    node = malloc(sizeof(calqueue_node_t));
+  }
+  node->key = q->key(ptr);
+  node->ptr = ptr;
+
+  if (q->size == 0 || node->key < q->last_key){
+    start_at(q, node->key);
+  }
+  insert_node(q, node, 0);
+  q->size++;
+
+  if (q->size > 2 * q->num_buckets){
+    resize(q, 2 * q->num_buckets);
+  }
+}
+
+
+/**
+  Retrieves, but does not remove, the earliest element of the queue.
+
+  @param q a pointer to an instance of the calqueue_t data structure
+  @return the earliest element (the first to come of those with its time)
+  @return NULL if the queue is empty
+ */
+void *calqueue_peek(calqueue_t *q)
+{
+  if (q->size == 0){
+    return NULL;
+  }
+  return find_min(q)->head->ptr;
+}
+
+
+/**
+  Retrieves and removes the earliest element of the queue in O(1) on
+  average.
+
+  @param q a pointer to an instance of the calqueue_t data structure
+  @return the earliest element (the first to come of those with its time)
+  @return NULL if the queue is empty
+ */
+void *calqueue_poll(calqueue_t *q)
+{
+  if (q->size == 0){
+    return NULL;
+  }
+  calqueue_node_t *node = unlink_min(q);
+  void *ptr = node->ptr;
+  node->next = q->free_nodes;
+  q->free_nodes = node;
+  q->size--;
+
+  if (q->num_buckets > MIN_BUCKETS && q->size < q->num_buckets / 2){
+    resize(q, q->num_buckets / 2);
+  }
+  return ptr;
+}
+
+
+/**
+  Return the number of elements in the queue.
+
+  @param q a pointer to an instance of the calqueue_t data structure
+  @return the number of elements in the queue
+ */
+int calqueue_size(calqueue_t *q)
+{
+  return q->size;
+}
+
+
+/**
+  Copies the elements of the queue into out in O(n), bucket by bucket, so
+  not in time order.
+
+  @param q a pointer to an instance of the calqueue_t data structure
+  @param out an array of at least calqueue_size(q) pointers
+  @return the number of elements copied
+ */
+int calqueue_to_array(calqueue_t *q, void **out)
+{
+  int count = 0, i;
+  calqueue_node_t *node;
+
+  for (i = 0; i < q->num_buckets; i++){
+    for (node = q->buckets[i].head; node != NULL; node = node->next){
+      out[count++] = node->ptr;
+    }
+  }
+  return count;
+}
+
+
+/**
+  Destroys and frees all the memory associated with q. The elements
+  themselves are not freed.
+
+  @param q a pointer to an instance of the calqueue_t data structure
+ */
+void calqueue_destroy(calqueue_t *q)
+{
+  int i;
+  for (i = 0; i < q->num_buckets; i++){
+    while (q->buckets[i].head != NULL){
+      calqueue_node_t *next = q->buckets[i].head->next;
+      free(q->buckets[i].head);
+      q->buckets[i].head = next;
+    }
+  }
+  while (q->free_nodes != NULL){
+    calqueue_node_t *next = q->free_nodes->next;
+    free(q->free_nodes);
+    q->free_nodes = next;
+  }
+  free(q->buckets);
+  q->buckets = NULL;
+  q->num_buckets = 0;
+  q->size = 0;
+}
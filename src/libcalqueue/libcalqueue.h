@@ -0,0 +1,60 @@
+/** @file libcalqueue.h
+ */
+
+#ifndef LIBCALQUEUE_H_
+#define LIBCALQUEUE_H_
+
+/**
+  Calendar Queue Data Structure
+
+  A priority queue of elements keyed by a non-negative time, after R. Brown,
+  "Calendar queues" (CACM, 1988). Keys hash into a ring of buckets, each a
+  sorted list covering width time units of every "year" of
+  num_buckets * width time units. A dequeue walks the ring from the last
+  dequeued key, so when the width matches the spacing of the keys both
+  operations take O(1) on average. The ring doubles or halves as the queue
+  grows or shrinks, and every resize re-estimates the width from the
+  earliest keys. Elements with equal keys leave in the order they came.
+*/
+
+typedef struct _calqueue_node_t
+{
+  long long key;
+  void *ptr;
+  struct _calqueue_node_t *next;
+
+} calqueue_node_t;
+
+typedef struct _calqueue_bucket_t
+{
+  calqueue_node_t *head;
+  calqueue_node_t *tail;      //so that a key at or after the last one appends
+
+} calqueue_bucket_t;
+
+typedef struct _calqueue_t
+{
+  calqueue_bucket_t *buckets;
+  int num_buckets;            //a power of two
+  long long width;            //time units per bucket
+  int size;
+  int last_bucket;            //where the next dequeue starts looking
+  long long bucket_top;       //end of last_bucket's window in the current year
+  long long last_key;         //no key in the queue is smaller
+  calqueue_node_t *free_nodes;
+  long long (*key)(const void *);
+
+} calqueue_t;
+
+
+void   calqueue_init     (calqueue_t *q, long long (*key)(const void *));
+
+void   calqueue_push     (calqueue_t *q, void *ptr);
+void * calqueue_peek     (calqueue_t *q);
+void * calqueue_poll     (calqueue_t *q);
+int    calqueue_size     (calqueue_t *q);
+int    calqueue_to_array (calqueue_t *q, void **out);
+
+void   calqueue_destroy  (calqueue_t *q);
+
+#endif /* LIBCALQUEUE_H_ */
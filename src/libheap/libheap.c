@@ -0,0 +1,187 @@
+/** @file libheap.c
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "libheap.h"
+
+
+static void sift_up(heap_t *h, int index)
+{
+  void *ptr = h->data[index];
+  while (index > 0){
+    int parent = (index - 1) / 2;
+    if (h->comparer(ptr, h->data[parent]) >= 0){
+      break;
+    }
+    h->data[index] = h->data[parent];
+    index = parent;
+  }
+  h->data[index] = ptr;
+}
+
+
+static void sift_down(heap_t *h, int index)
+{
+  void *ptr = h->data[index];
+  while (1){
+    int child = 2 * index + 1;
+    if (child >= h->size){
+      break;
+    }
+    if (child + 1 < h->size && h->comparer(h->data[child + 1], h->data[child]) < 0){
+      child++;
+    }
+    if (h->comparer(h->data[child], ptr) >= 0){
+      break;
+    }
+    h->data[index] = h->data[child];
+    index = child;
+  }
+  h->data[index] = ptr;
+}
+
+
+/**
+  Initializes the heap_t data structure.
+
+  @param h a pointer to an instance of the heap_t data structure
+  @param comparer a function pointer that compares two elements.
+ */
+void heap_init(heap_t *h, int(*comparer)(const void *, const void *))
+{
+  h->data = NULL;
+  h->size = 0;
+  h->capacity = 0;
+  h->comparer = comparer;
+}
+
+
+/**
+  Insert the specified element into the heap in O(log n).
+
+  @param h a pointer to an instance of the heap_t data structure
+  @param ptr a pointer to the data to be inserted
+ */
+void heap_push(heap_t *h, void *ptr)
+{
+  if (h->size == h->capacity){
+    h->capacity = (h->capacity == 0) ? 16 : h->capacity * 2;
+    h->data = realloc(h->data, h->capacity * sizeof(void *));
+  }
+  h->data[h->size] = ptr;
+  h->size++;
+  sift_up(h, h->size - 1);
+}
+
+
+/**
+  Retrieves, but does not remove, the smallest element of the heap.
+
+  @param h a pointer to an instance of the heap_t data structure
+  @return the smallest element
+  @return NULL if the heap is empty
+ */
+void *heap_peek(heap_t *h)
+{
+  if (h->size == 0){
+    return NULL;
+  }
+  return h->data[0];
+}
+
+
+/**
+  Retrieves and removes the smallest element of the heap in O(log n).
+
+  @param h a pointer to an instance of the heap_t data structure
+  @return the smallest element
+  @return NULL if the heap is empty
+ */
+void *heap_poll(heap_t *h)
+{
+  if (h->size == 0){
+    return NULL;
+  }
+  void *top = h->data[0];
+  h->size--;
+  if (h->size > 0){
+    h->data[0] = h->data[h->size];
+    sift_down(h, 0);
+  }
+  return top;
+}
+
+
+/**
+  Returns the element stored at the given position of the heap array. Only
+  index 0 is guaranteed to be the smallest; the rest are in heap order.
+
+  @param h a pointer to an instance of the heap_t data structure
+  @param index position of retrieved element
+  @return the index'th element of the heap array
+  @return NULL if the heap does not contain the index'th element
+ */
+void *heap_at(heap_t *h, int index)
+{
+  if (index < 0 || index >= h->size){
+    return NULL;
+  }
+  return h->data[index];
+}
+
+
+/**
+  Removes ptr from the heap. The element is found by a linear scan of the
+  heap array, so this is O(n); the heap is then repaired in O(log n).
+
+  @param h a pointer to an instance of the heap_t data structure
+  @param ptr address of element to be removed
+  @return the number of entries removed (0 or 1)
+ */
+int heap_remove(heap_t *h, void *ptr)
+{
+  int index;
+  for (index = 0; index < h->size; index++){
+    if (h->data[index] == ptr){
+      break;
+    }
+  }
+  if (index == h->size){
+    return 0;
+  }
+  h->size--;
+  if (index < h->size){
+    h->data[index] = h->data[h->size];
+    sift_down(h, index);
+    sift_up(h, index);
+  }
+  return 1;
+}
+
+
+/**
+  Return the number of elements in the heap.
+
+  @param h a pointer to an instance of the heap_t data structure
+  @return the number of elements in the heap
+ */
+int heap_size(heap_t *h)
+{
+  return h->size;
+}
+
+
+/**
+  Destroys and frees all the memory associated with h.
+
+  @param h a pointer to an instance of the heap_t data structure
+ */
+void heap_destroy(heap_t *h)
+{
+  free(h->data);
+  h->data = NULL;
+  h->size = 0;
+  h->capacity = 0;
+}
@@ -0,0 +1,32 @@
+/** @file libheap.h
+ */
+
+#ifndef LIBHEAP_H_
+#define LIBHEAP_H_
+
+/**
+  Binary Min-Heap Data Structure
+*/
+
+typedef struct _heap_t
+{
+  void **data;
+  int size;
+  int capacity;
+  int (*comparer)(const void *, const void *);
+
+} heap_t;
+
+
+void   heap_init     (heap_t *h, int(*comparer)(const void *, const void *));
+
+void   heap_push     (heap_t *h, void *ptr);
+void * heap_peek     (heap_t *h);
+void * heap_poll     (heap_t *h);
+void * heap_at       (heap_t *h, int index);
+int    heap_remove   (heap_t *h, void *ptr);
+int    heap_size     (heap_t *h);
+
+void   heap_destroy  (heap_t *h);
+
+#endif /* LIBHEAP_H_ */
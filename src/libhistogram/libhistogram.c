@@ -0,0 +1,171 @@
+/** @file libhistogram.c
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "libhistogram.h"
+
+#define SUB_COUNT (1 << HISTOGRAM_SUB_BITS)
+#define HALF_COUNT (1 << (HISTOGRAM_SUB_BITS - 1))
+
+
+static int bucket_index(unsigned long long value)
+{
+  if (value < SUB_COUNT){
+    return (int)value;
+  }
+  int msb = 63 - __builtin_clzll(value);
+  int shift = msb - (HISTOGRAM_SUB_BITS - 1);
+  int top = (int)(value >> shift);
+  return SUB_COUNT + (shift - 1) * HALF_COUNT + (top - HALF_COUNT);
+}
+
+
+/* The largest value that falls in the bucket. */
+static unsigned long long bucket_value(int index)
+{
+  if (index < SUB_COUNT){
+    return index;
+  }
+  int shift = (index - SUB_COUNT) / HALF_COUNT + 1;
+  unsigned long long top = (index - SUB_COUNT) % HALF_COUNT + HALF_COUNT;
+  return ((top + 1) << shift) - 1;
+}
+
+
+/**
+  Initializes the histogram_t data structure to hold no values.
+
+  @param h a pointer to an instance of the histogram_t data structure
+ */
+void histogram_init(histogram_t *h)
+{
+  memset(h->counts, 0, sizeof(h->counts));
+  h->total = 0;
+  h->sum = 0;
+  h->min = 0;
+  h->max = 0;
+}
+
+
+/**
+  Records one value in O(1).
+
+  @param h a pointer to an instance of the histogram_t data structure
+  @param value the value to record
+ */
+void histogram_record(histogram_t *h, unsigned long long value)
+{
+  h->counts[bucket_index(value)]++;
+  if (h->total == 0 || value < h->min){
+    h->min = value;
+  }
+  if (value > h->max){
+    h->max = value;
+  }
+  h->total++;
+  h->sum += value;
+}
+
+
+/**
+  Adds every value recorded in other to h, as if they had been recorded in
+  h directly.
+
+  @param h a pointer to an instance of the histogram_t data structure
+  @param other the histogram to add, left unchanged
+ */
+void histogram_merge(histogram_t *h, histogram_t *other)
+{
+  int i;
+  if (other->total == 0){
+    return;
+  }
+  for (i = 0; i < HISTOGRAM_BUCKETS; i++){
+    h->counts[i] += other->counts[i];
+  }
+  if (h->total == 0 || other->min < h->min){
+    h->min = other->min;
+  }
+  if (other->max > h->max){
+    h->max = other->max;
+  }
+  h->total += other->total;
+  h->sum += other->sum;
+}
+
+
+/**
+  Returns the rank'th smallest recorded value (1-based), rounded up to the
+  end of its bucket but never above the largest recorded value.
+
+  @param h a pointer to an instance of the histogram_t data structure
+  @param rank the rank, between 1 and the number of recorded values
+  @return the value at the given rank, 0 if the histogram is empty
+ */
+unsigned long long histogram_at_rank(histogram_t *h, unsigned long long rank)
+{
+  if (h->total == 0){
+    return 0;
+  }
+  if (rank >= h->total){
+    return h->max;
+  }
+  unsigned long long seen = 0;
+  int i;
+  for (i = 0; i < HISTOGRAM_BUCKETS; i++){
+    seen += h->counts[i];
+    if (seen >= rank){
+      unsigned long long value = bucket_value(i);
+      return (value > h->max) ? h->max : value;
+    }
+  }
+  return h->max;
+}
+
+
+/**
+  Returns a percentile of the recorded values, using the nearest-rank
+  method.
+
+  @param h a pointer to an instance of the histogram_t data structure
+  @param percentile the percentile to return, between 0 and 100
+  @return the value at the given percentile, 0 if the histogram is empty
+ */
+unsigned long long histogram_percentile(histogram_t *h, double percentile)
+{
+  unsigned long long rank = (unsigned long long)(percentile / 100.0 * h->total + 0.999999);
+  if (rank < 1){
+    rank = 1;
+  }
+  return histogram_at_rank(h, rank);
+}
+
+
+/**
+  Returns the exact mean of the recorded values.
+
+  @param h a pointer to an instance of the histogram_t data structure
+  @return the mean, 0 if the histogram is empty
+ */
+double histogram_mean(histogram_t *h)
+{
+  if (h->total == 0){
+    return 0.0;
+  }
+  return (double)h->sum / h->total;
+}
+
+
+/**
+  Return the number of recorded values.
+
+  @param h a pointer to an instance of the histogram_t data structure
+  @return the number of recorded values
+ */
+unsigned long long histogram_count(histogram_t *h)
+{
+  return h->total;
+}
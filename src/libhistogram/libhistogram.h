@@ -0,0 +1,39 @@
+/** @file libhistogram.h
+ */
+
+#ifndef LIBHISTOGRAM_H_
+#define LIBHISTOGRAM_H_
+
+/**
+  Log-Linear Histogram Data Structure
+
+  Values below 2^HISTOGRAM_SUB_BITS are counted exactly; above that every
+  power of two is split into 2^(HISTOGRAM_SUB_BITS-1) equal buckets, so a
+  reported percentile is within about 1/16 of the true value. The memory is
+  fixed no matter how many values are recorded.
+*/
+
+#define HISTOGRAM_SUB_BITS 5
+#define HISTOGRAM_BUCKETS ((1 << HISTOGRAM_SUB_BITS) + (64 - HISTOGRAM_SUB_BITS) * (1 << (HISTOGRAM_SUB_BITS - 1)))
+
+typedef struct _histogram_t
+{
+  unsigned long long counts[HISTOGRAM_BUCKETS];
+  unsigned long long total;
+  unsigned long long sum;
+  unsigned long long min;
+  unsigned long long max;
+
+} histogram_t;
+
+
+void               histogram_init      (histogram_t *h);
+
+void               histogram_record    (histogram_t *h, unsigned long long value);
+void               histogram_merge     (histogram_t *h, histogram_t *other);
+unsigned long long histogram_at_rank   (histogram_t *h, unsigned long long rank);
+unsigned long long histogram_percentile(histogram_t *h, double percentile);
+double             histogram_mean      (histogram_t *h);
+unsigned long long histogram_count     (histogram_t *h);
+
+#endif /* LIBHISTOGRAM_H_ */
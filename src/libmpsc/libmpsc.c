@@ -0,0 +1,139 @@
+/** @file libmpsc.c
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "libmpsc.h"
+
+
+static unsigned long *slot_sequence(mpsc_t *q, unsigned long pos)
+{
+  return (unsigned long *)(q->slots + (pos & q->mask) * q->slot_size);
+}
+
+
+/**
+  Initializes the mpsc_t data structure.
+
+  @param q a pointer to an instance of the mpsc_t data structure
+  @param capacity the number of elements the ring holds, rounded up to a
+  power of two
+  @param elem_size the size of an element in bytes
+  @return 0 on success, -1 if capacity is not positive or memory ran out
+ */
+int mpsc_init(mpsc_t *q, int capacity, size_t elem_size)
+{
+  unsigned long size = 1, i;
+  if (capacity <= 0){
+    return -1;
+  }
+  while (size < (unsigned long)capacity){
+    size *= 2;
+  }
+
+  q->elem_size = elem_size;
+  q->slot_size = (sizeof(unsigned long) + elem_size + sizeof(unsigned long) - 1) & ~(sizeof(unsigned long) - 1);
+  q->mask = size - 1;
+  q->slots = malloc(size * q->slot_size);
+  if (q->slots == NULL){
+    return -1;
+  }
+  for (i = 0; i < size; i++){
+    *slot_sequence(q, i) = i;
+  }
+  q->head = 0;
+  q->tail = 0;
+  return 0;
+}
+
+
+/**
+  Copies an element into the ring without blocking; safe to call from any
+  number of threads at once. A producer claims a slot by advancing head with
+  a compare-and-swap, writes the element, then publishes it by setting the
+  slot's sequence number, so a slow producer only delays the consumer, not
+  the other producers.
+
+  @param q a pointer to an instance of the mpsc_t data structure
+  @param elem a pointer to the elem_size bytes to copy in
+  @return 1 if the element was added, 0 if the ring is full
+ */
+int mpsc_offer(mpsc_t *q, const void *elem)
+{
+  unsigned long pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+  while (1){
+    unsigned long *sequence = slot_sequence(q, pos);
+    long diff = (long)(__atomic_load_n(sequence, __ATOMIC_ACQUIRE) - pos);
+    if (diff == 0){
+      //the slot is free: claim it, or learn the new head on failure
+      if (__atomic_compare_exchange_n(&q->head, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)){
+        memcpy(sequence + 1, elem, q->elem_size);
+        __atomic_store_n(sequence, pos + 1, __ATOMIC_RELEASE);
+        return 1;
+      }
+    } else if (diff < 0){
+      //the consumer has not read this slot since the last lap
+      return 0;
+    } else {
+      pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+    }
+  }
+}
+
+
+/**
+  Removes up to max elements from the ring, oldest first. Only one thread
+  may drain a ring at a time. Draining stops early at a slot that a producer
+  has claimed but not finished writing.
+
+  @param q a pointer to an instance of the mpsc_t data structure
+  @param out room for max elements
+  @param max the largest number of elements to remove
+  @return the number of elements copied to out
+ */
+int mpsc_drain(mpsc_t *q, void *out, int max)
+{
+  unsigned long pos = q->tail;
+  int count = 0;
+  while (count < max){
+    unsigned long *sequence = slot_sequence(q, pos);
+    if (__atomic_load_n(sequence, __ATOMIC_ACQUIRE) != pos + 1){
+      break;
+    }
+    memcpy((unsigned char *)out + count * q->elem_size, sequence + 1, q->elem_size);
+    __atomic_store_n(sequence, pos + q->mask + 1, __ATOMIC_RELEASE);
+    pos++;
+    count++;
+  }
+  __atomic_store_n(&q->tail, pos, __ATOMIC_RELAXED);
+  return count;
+}
+
+
+/**
+  Return the number of elements in the ring. While producers are offering
+  this is only a snapshot, and it counts claimed slots not yet published.
+
+  @param q a pointer to an instance of the mpsc_t data structure
+  @return the number of elements in the ring
+ */
+int mpsc_size(mpsc_t *q)
+{
+  unsigned long tail = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+  unsigned long head = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+  return (int)(head - tail);
+}
+
+
+/**
+  Destroys and frees all the memory associated with q. No thread may be
+  using the ring.
+
+  @param q a pointer to an instance of the mpsc_t data structure
+ */
+void mpsc_destroy(mpsc_t *q)
+{
+  free(q->slots);
+  q->slots = NULL;
+}
@@ -0,0 +1,42 @@
+/** @file libmpsc.h
+ */
+
+#ifndef LIBMPSC_H_
+#define LIBMPSC_H_
+
+#include <stddef.h>
+
+/**
+  Bounded Multi-Producer Single-Consumer Ring
+
+  Any number of threads may offer elements at the same time without taking
+  a lock; one thread at a time drains them, in the order the producers
+  claimed their slots. Elements are copied in and out, so producers need not
+  keep them alive. Every slot carries a sequence number that tells whose
+  turn it is: the producer that claimed it, or the consumer.
+*/
+
+#define MPSC_CACHE_LINE 64
+
+typedef struct _mpsc_t
+{
+  unsigned char *slots;
+  size_t elem_size;
+  size_t slot_size;
+  unsigned long mask; //capacity - 1, the capacity being a power of two
+
+  unsigned long head __attribute__((aligned(MPSC_CACHE_LINE))); //next slot a producer claims
+  unsigned long tail __attribute__((aligned(MPSC_CACHE_LINE))); //next slot the consumer reads
+
+} mpsc_t;
+
+
+int    mpsc_init     (mpsc_t *q, int capacity, size_t elem_size);
+
+int    mpsc_offer    (mpsc_t *q, const void *elem);
+int    mpsc_drain    (mpsc_t *q, void *out, int max);
+int    mpsc_size     (mpsc_t *q);
+
+void   mpsc_destroy  (mpsc_t *q);
+
+#endif /* LIBMPSC_H_ */
@@ -84,6 +84,56 @@ int priqueue_offer(priqueue_t *q, void *ptr)
 }
 
 
+/**
+  Inserts count elements that are already sorted by the comparer (equal
+  elements in the order they should be offered) in a single pass over the
+  queue. The result is the same as calling priqueue_offer() on each of them
+  in order, but costs O(n + count) instead of O(n * count).
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param ptrs the elements to insert, sorted by the comparer
+  @param count the number of elements in ptrs
+ */
+void priqueue_offer_sorted(priqueue_t *q, void **ptrs, int count)
+{
+  Node *temp = q->top;
+  int i;
+  for (i = 0; i < count; i++){
+    struct Node *new = malloc(sizeof(Node));
+    new->data = ptrs[i];
+    new->next = NULL;
+    new->prev = NULL;
+
+    //elements after temp were skipped for an earlier, smaller element
+    while (temp != NULL && !(q->comparer(new->data, temp->data) < 0)){
+      temp = temp->next;
+    }
+
+    if (temp == NULL){
+      //inserting at the end of queue
+      new->prev = q->tail;
+      if (q->tail != NULL){
+        q->tail->next = new;
+      } else {
+        q->top = new;
+      }
+      q->tail = new;
+    } else {
+      //inserting before temp
+      new->prev = temp->prev;
+      new->next = temp;
+      if (temp->prev != NULL){
+        temp->prev->next = new;
+      } else {
+        q->top = new;
+      }
+      temp->prev = new;
+    }
+    q->size++;
+  }
+}
+
+
 /**
   Retrieves, but does not remove, the head of this queue, returning NULL if
   this queue is empty.
@@ -121,10 +171,16 @@ void *priqueue_poll(priqueue_t *q)
   } else {
     //will set next element in queue as top and remove the previous top
     Node *temp = q->top;
+    void *data = temp->data;
     q->top = temp->next;
-    q->top->prev = NULL;
+    if (q->top != NULL){
+      q->top->prev = NULL;
+    } else {
+      q->tail = NULL;
+    }
     q->size--;
-    return temp->data;
+    free(temp);
+    return data;
   }
 }
 
@@ -180,7 +236,9 @@ int priqueue_remove(priqueue_t *q, void *ptr)
         q->tail = temp->prev;
       }
 
-      temp = temp->next;
+      Node *next = temp->next;
+      free(temp);
+      temp = next;
       remove++;
       q->size--;
     } else {
@@ -222,7 +280,9 @@ void *priqueue_remove_at(priqueue_t *q, int index)
         }
 
         q->size--;
-        return temp->data;
+        void *data = temp->data;
+        free(temp);
+        return data;
       }
       currentindex++;
       temp = temp->next;
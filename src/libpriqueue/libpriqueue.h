@@ -29,6 +29,7 @@ typedef struct _priqueue_t
 void   priqueue_init     (priqueue_t *q, int(*comparer)(const void *, const void *));
 
 int    priqueue_offer    (priqueue_t *q, void *ptr);
+void   priqueue_offer_sorted(priqueue_t *q, void **ptrs, int count);
 void * priqueue_peek     (priqueue_t *q);
 void * priqueue_poll     (priqueue_t *q);
 void * priqueue_at       (priqueue_t *q, int index);
@@ -0,0 +1,443 @@
+/** @file librbtree.c
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "librbtree.h"
+
+
+static void rotate_left(rbtree_t *t, RBNode *x)
+{
+  RBNode *y = x->right;
+  x->right = y->left;
+  if (y->left != NULL){
+    y->left->parent = x;
+  }
+  y->parent = x->parent;
+  if (x->parent == NULL){
+    t->root = y;
+  } else if (x == x->parent->left){
+    x->parent->left = y;
+  } else {
+    x->parent->right = y;
+  }
+  y->left = x;
+  x->parent = y;
+}
+
+
+static void rotate_right(rbtree_t *t, RBNode *x)
+{
+  RBNode *y = x->left;
+  x->left = y->right;
+  if (y->right != NULL){
+    y->right->parent = x;
+  }
+  y->parent = x->parent;
+  if (x->parent == NULL){
+    t->root = y;
+  } else if (x == x->parent->right){
+    x->parent->right = y;
+  } else {
+    x->parent->left = y;
+  }
+  y->right = x;
+  x->parent = y;
+}
+
+
+static RBNode *subtree_min(RBNode *n)
+{
+  while (n->left != NULL){
+    n = n->left;
+  }
+  return n;
+}
+
+
+static RBNode *successor(RBNode *n)
+{
+  if (n->right != NULL){
+    return subtree_min(n->right);
+  }
+  RBNode *p = n->parent;
+  while (p != NULL && n == p->right){
+    n = p;
+    p = p->parent;
+  }
+  return p;
+}
+
+
+/**
+  Initializes the rbtree_t data structure.
+
+  @param t a pointer to an instance of the rbtree_t data structure
+  @param comparer a function pointer that compares two elements. It must
+  define a total order (only an element compares equal to itself), since it
+  is also used to locate elements on removal.
+ */
+void rbtree_init(rbtree_t *t, int(*comparer)(const void *, const void *))
+{
+  t->root = NULL;
+  t->leftmost = NULL;
+  t->size = 0;
+  t->comparer = comparer;
+}
+
+
+/**
+  Insert the specified element into the tree in O(log n).
+
+  @param t a pointer to an instance of the rbtree_t data structure
+  @param ptr a pointer to the data to be inserted
+ */
+void rbtree_insert(rbtree_t *t, void *ptr)
+{
+  RBNode *new = malloc(sizeof(RBNode));
+  new->data = ptr;
+  new->left = NULL;
+  new->right = NULL;
+  new->parent = NULL;
+  new->red = 1;
+
+  RBNode *parent = NULL;
+  RBNode *temp = t->root;
+  int leftmost = 1;
+  while (temp != NULL){
+    parent = temp;
+    if (t->comparer(ptr, temp->data) < 0){
+      temp = temp->left;
+    } else {
+      temp = temp->right;
+      leftmost = 0;
+    }
+  }
+
+  new->parent = parent;
+  if (parent == NULL){
+    t->root = new;
+  } else if (t->comparer(ptr, parent->data) < 0){
+    parent->left = new;
+  } else {
+    parent->right = new;
+  }
+  if (leftmost){
+    t->leftmost = new;
+  }
+  t->size++;
+
+  //restore the red-black properties
+  RBNode *x = new;
+  while (x != t->root && x->parent->red){
+    RBNode *gp = x->parent->parent;
+    if (x->parent == gp->left){
+      RBNode *uncle = gp->right;
+      if (uncle != NULL && uncle->red){
+        x->parent->red = 0;
+        uncle->red = 0;
+        gp->red = 1;
+        x = gp;
+      } else {
+        if (x == x->parent->right){
+          x = x->parent;
+          rotate_left(t, x);
+        }
+        x->parent->red = 0;
+        gp->red = 1;
+        rotate_right(t, gp);
+      }
+    } else {
+      RBNode *uncle = gp->left;
+      if (uncle != NULL && uncle->red){
+        x->parent->red = 0;
+        uncle->red = 0;
+        gp->red = 1;
+        x = gp;
+      } else {
+        if (x == x->parent->left){
+          x = x->parent;
+          rotate_right(t, x);
+        }
+        x->parent->red = 0;
+        gp->red = 1;
+        rotate_left(t, gp);
+      }
+    }
+  }
+  t->root->red = 0;
+}
+
+
+static void delete_node(rbtree_t *t, RBNode *z)
+{
+  if (z == t->leftmost){
+    t->leftmost = successor(z);
+  }
+
+  RBNode *y = z;
+  RBNode *x;
+  RBNode *x_parent;
+  int removed_red = y->red;
+
+  if (z->left == NULL || z->right == NULL){
+    x = (z->left != NULL) ? z->left : z->right;
+    x_parent = z->parent;
+    if (x != NULL){
+      x->parent = z->parent;
+    }
+    if (z->parent == NULL){
+      t->root = x;
+    } else if (z == z->parent->left){
+      z->parent->left = x;
+    } else {
+      z->parent->right = x;
+    }
+  } else {
+    //splice the in-order successor into z's position
+    y = subtree_min(z->right);
+    removed_red = y->red;
+    x = y->right;
+    if (y->parent == z){
+      x_parent = y;
+    } else {
+      x_parent = y->parent;
+      y->parent->left = x;
+      if (x != NULL){
+        x->parent = y->parent;
+      }
+      y->right = z->right;
+      z->right->parent = y;
+    }
+    y->parent = z->parent;
+    if (z->parent == NULL){
+      t->root = y;
+    } else if (z == z->parent->left){
+      z->parent->left = y;
+    } else {
+      z->parent->right = y;
+    }
+    y->left = z->left;
+    z->left->parent = y;
+    y->red = z->red;
+  }
+
+  free(z);
+  t->size--;
+
+  if (removed_red){
+    return;
+  }
+
+  //restore the red-black properties
+  while (x != t->root && (x == NULL || !x->red)){
+    if (x == x_parent->left){
+      RBNode *w = x_parent->right;
+      if (w->red){
+        w->red = 0;
+        x_parent->red = 1;
+        rotate_left(t, x_parent);
+        w = x_parent->right;
+      }
+      if ((w->left == NULL || !w->left->red) && (w->right == NULL || !w->right->red)){
+        w->red = 1;
+        x = x_parent;
+        x_parent = x->parent;
+      } else {
+        if (w->right == NULL || !w->right->red){
+          w->left->red = 0;
+          w->red = 1;
+          rotate_right(t, w);
+          w = x_parent->right;
+        }
+        w->red = x_parent->red;
+        x_parent->red = 0;
+        w->right->red = 0;
+        rotate_left(t, x_parent);
+        x = t->root;
+        x_parent = NULL;
+      }
+    } else {
+      RBNode *w = x_parent->left;
+      if (w->red){
+        w->red = 0;
+        x_parent->red = 1;
+        rotate_right(t, x_parent);
+        w = x_parent->left;
+      }
+      if ((w->left == NULL || !w->left->red) && (w->right == NULL || !w->right->red)){
+        w->red = 1;
+        x = x_parent;
+        x_parent = x->parent;
+      } else {
+        if (w->left == NULL || !w->left->red){
+          w->right->red = 0;
+          w->red = 1;
+          rotate_left(t, w);
+          w = x_parent->left;
+        }
+        w->red = x_parent->red;
+        x_parent->red = 0;
+        w->left->red = 0;
+        rotate_right(t, x_parent);
+        x = t->root;
+        x_parent = NULL;
+      }
+    }
+  }
+  if (x != NULL){
+    x->red = 0;
+  }
+}
+
+
+/**
+  Retrieves, but does not remove, the smallest element of the tree in O(1).
+
+  @param t a pointer to an instance of the rbtree_t data structure
+  @return the smallest element
+  @return NULL if the tree is empty
+ */
+void *rbtree_min(rbtree_t *t)
+{
+  if (t->leftmost == NULL){
+    return NULL;
+  }
+  return t->leftmost->data;
+}
+
+
+/**
+  Retrieves and removes the smallest element of the tree in O(log n).
+
+  @param t a pointer to an instance of the rbtree_t data structure
+  @return the smallest element
+  @return NULL if the tree is empty
+ */
+void *rbtree_poll_min(rbtree_t *t)
+{
+  if (t->leftmost == NULL){
+    return NULL;
+  }
+  void *data = t->leftmost->data;
+  delete_node(t, t->leftmost);
+  return data;
+}
+
+
+/**
+  Returns the index'th element in sorted order. This walks the tree in order
+  and is meant for debugging output, not for the scheduling hot path.
+
+  @param t a pointer to an instance of the rbtree_t data structure
+  @param index position of retrieved element
+  @return the index'th element
+  @return NULL if the tree does not contain the index'th element
+ */
+void *rbtree_at(rbtree_t *t, int index)
+{
+  if (index < 0 || index >= t->size){
+    return NULL;
+  }
+  RBNode *temp = t->leftmost;
+  while (index > 0){
+    temp = successor(temp);
+    index--;
+  }
+  return temp->data;
+}
+
+
+/**
+  Copies every element into out in sorted order, equal elements in the
+  order they were inserted. Unlike calling rbtree_at() for each index this
+  takes O(n).
+
+  @param t a pointer to an instance of the rbtree_t data structure
+  @param out where to store the elements, room for rbtree_size(t) of them
+  @return the number of elements copied
+ */
+int rbtree_to_array(rbtree_t *t, void **out)
+{
+  RBNode *temp = t->leftmost;
+  int count = 0;
+  while (temp != NULL){
+    out[count++] = temp->data;
+    temp = successor(temp);
+  }
+  return count;
+}
+
+
+/**
+  Removes ptr from the tree in O(log n). The element is located with the
+  comparer, so its ordering key must not have changed since insertion.
+
+  @param t a pointer to an instance of the rbtree_t data structure
+  @param ptr address of element to be removed
+  @return the number of entries removed (0 or 1)
+ */
+int rbtree_remove(rbtree_t *t, void *ptr)
+{
+  RBNode *temp = t->root;
+  while (temp != NULL){
+    if (temp->data == ptr){
+      delete_node(t, temp);
+      return 1;
+    }
+    if (t->comparer(ptr, temp->data) < 0){
+      temp = temp->left;
+    } else {
+      temp = temp->right;
+    }
+  }
+  return 0;
+}
+
+
+/**
+  Looks up an element that compares equal to key in O(log n).
+
+  @param t a pointer to an instance of the rbtree_t data structure
+  @param key an element with the ordering key to look for
+  @return an element equal to key
+  @return NULL if the tree contains no such element
+ */
+void *rbtree_find(rbtree_t *t, const void *key)
+{
+  RBNode *temp = t->root;
+  while (temp != NULL){
+    int order = t->comparer(key, temp->data);
+    if (order == 0){
+      return temp->data;
+    }
+    temp = (order < 0) ? temp->left : temp->right;
+  }
+  return NULL;
+}
+
+
+/**
+  Return the number of elements in the tree.
+
+  @param t a pointer to an instance of the rbtree_t data structure
+  @return the number of elements in the tree
+ */
+int rbtree_size(rbtree_t *t)
+{
+  return t->size;
+}
+
+
+/**
+  Destroys and frees all the memory associated with t.
+
+  @param t a pointer to an instance of the rbtree_t data structure
+ */
+void rbtree_destroy(rbtree_t *t)
+{
+  while (t->size != 0){
+    rbtree_poll_min(t);
+  }
+}
@@ -0,0 +1,44 @@
+/** @file librbtree.h
+ */
+
+#ifndef LIBRBTREE_H_
+#define LIBRBTREE_H_
+
+/**
+  Red-Black Tree Data Structure
+*/
+
+typedef struct RBNode
+{
+  void *data;
+  struct RBNode *parent;
+  struct RBNode *left;
+  struct RBNode *right;
+  int red;
+
+} RBNode;
+
+typedef struct _rbtree_t
+{
+  struct RBNode *root;
+  struct RBNode *leftmost;
+  int size;
+  int (*comparer)(const void *, const void *);
+
+} rbtree_t;
+
+
+void   rbtree_init     (rbtree_t *t, int(*comparer)(const void *, const void *));
+
+void   rbtree_insert   (rbtree_t *t, void *ptr);
+void * rbtree_min      (rbtree_t *t);
+void * rbtree_poll_min (rbtree_t *t);
+void * rbtree_at       (rbtree_t *t, int index);
+int    rbtree_to_array (rbtree_t *t, void **out);
+int    rbtree_remove   (rbtree_t *t, void *ptr);
+void * rbtree_find     (rbtree_t *t, const void *key);
+int    rbtree_size     (rbtree_t *t);
+
+void   rbtree_destroy  (rbtree_t *t);
+
+#endif /* LIBRBTREE_H_ */
@@ -0,0 +1,29 @@
+/** @file cycles.h
+ */
+
+#ifndef CYCLES_H_
+#define CYCLES_H_
+
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/**
+  Reads a cheap, monotonically increasing cycle counter: the time-stamp
+  counter on x86, the monotonic clock in nanoseconds elsewhere. Only the
+  difference between two readings on the same thread is meaningful.
+*/
+static inline unsigned long long read_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+#endif /* CYCLES_H_ */
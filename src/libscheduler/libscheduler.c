@@ -5,317 +5,2470 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <dlfcn.h>
 
 #include "libscheduler.h"
+#include "cycles.h"
 #include "../libpriqueue/libpriqueue.h"
+#include "../librbtree/librbtree.h"
+#include "../libheap/libheap.h"
+#include "../libhistogram/libhistogram.h"
+#include "../libmpsc/libmpsc.h"
 
 
 /**
-  Stores information making up a job to be scheduled including any statistics.
+  The scheme in use is a scheduler_policy_ops table (see policy.h): one of
+  the built-in schemes or a policy loaded from a shared object. The library
+  keeps the ready queues, the cores and the statistics, and calls the
+  policy's hooks to order and pick the jobs.
+*/
+
+/**
+  A ready queue. Only the member matching queue_kind is in use.
+*/
+typedef struct _runqueue_t{
+  priqueue_t list;
+  rbtree_t tree;
+  heap_t heap;
+  long long length_time; //queue length summed over every time unit
+  long long steals;      //jobs this core took from another core's queue
+} runqueue_t;
+
+typedef scheduler_job_t job_t;
+
+/**
+  What a job that has blocked for I/O carries besides its scheduling keys.
+  Most jobs never block, so it is allocated when a job first does; until
+  then the job's current burst is its whole running time.
+*/
+typedef struct _scheduler_job_io_t{
+  scheduler_time_t burst_time;    //length of the current CPU burst
+  scheduler_time_t io_time;       //time units spent blocked for I/O so far
+  scheduler_time_t blocked_time;  //when the job last blocked for I/O
+  scheduler_time_t ready_time;    //when its I/O completed, -1 once it ran again
+} job_io_t;
+
+#define NUM_CLASSES 40
+
+/**
+  The state of one scheduler instance, see scheduler_create().
+*/
+struct _scheduler_t{
+  /**
+    There is one global ready queue, or one per core when per-core run
+    queues are enabled with scheduler_set_per_core_queues().
+  */
+  runqueue_t* runqueues;
+  int num_queues;
+  long long queued_jobs;
+  int affinity_window;
+
+  /**
+    The policy in use. Its comparator, queue kind and preemptive flag are
+    copied into comp, queue_kind and preemptive so that the hot paths do not
+    go through the table; the hooks are only called when they are set.
+  */
+  const scheduler_policy_ops* policy;
+  void* policy_handle; //from dlopen(), if the policy was loaded
+  queue_kind_t queue_kind;
+  int preemptive;
+  int (*comp)(const void *, const void *);
+  int comp_orders; //0 for a comparator like compareRR, which puts every job after every other
+
+  int num_cores;
+  long long num_jobs;
+  long long arrived_jobs;
+  scheduler_time_t current_time;
+  /**
+    The latency sums are exact: 64-bit integers hold the sum of 10^9 jobs'
+    latencies of up to 9 * 10^9 time units each.
+  */
+  long long wait_time;
+  long long turnaround_time;
+  long long response_time;
+  int target_latency;
+  int quantum_floor;      //adaptive RR is on when non-zero
+  long long burst_ewma;   //moving average of the running time of finished jobs, times 8
+  int aging_interval;
+  unsigned long long min_vruntime;
+  long long deadline_jobs;
+  long long deadline_misses;
+  histogram_t lateness_early; //how early the jobs that met their deadline finished
+  histogram_t lateness_late;  //how late the other jobs finished
+
+  /**
+    CPU share accounting per priority class (clamped to the nice range
+    -20..19), over the time units in which at least one job was waiting.
+  */
+  long long runnable_tickets;
+  long long class_tickets[NUM_CLASSES];
+  long long class_cpu_time[NUM_CLASSES];
+  double class_entitled_time[NUM_CLASSES];
+  long long contended_cpu_time;
+
+  /**
+    Latency distributions, overall and per priority class. The class
+    histograms are allocated the first time a job of the class finishes.
+  */
+  histogram_t latency[NUM_METRICS];
+  histogram_t* class_latency[NUM_CLASSES][NUM_METRICS];
+
+  job_t** core_used;
+  scheduler_time_t* core_stalled; //time units each core's job held it without running, since the last call
+  rbtree_t blocked; //jobs waiting for I/O, by job_id
+
+  /**
+    Speed of each core in SCHEDULER_SPEED_UNITs, or NULL when all cores run
+    at the nominal speed. A core retires running time in whole units and
+    keeps the fraction it has not retired yet in core_credit.
+  */
+  int* core_speed;
+  int* core_credit;
+
+  /**
+    Admission control, on when queue_limit is not -1: at most num_cores +
+    queue_limit jobs are running or queued at a time. Under the drop
+    policies every queued job is also kept in shed_order, whose minimum is
+    the job to drop next. Dropped jobs wait in shed_ids until the caller
+    collects them with scheduler_shed_job().
+  */
+  int queue_limit;
+  admission_t admission;
+  rbtree_t shed_order;
+  long long rejected_jobs;
+  long long dropped_jobs;
+  scheduler_id_t* shed_ids;
+  int shed_pending;
+  int shed_capacity;
+
+  /**
+    Arrivals submitted from other threads with scheduler_submit_job(), on
+    when submission_batch is not NULL. scheduler_drain_submissions() moves
+    them from the ring through submission_batch into the ready queue.
+  */
+  mpsc_t submissions;
+  scheduler_arrival_t* submission_batch;
+  int submission_capacity;
+
+#ifdef SCHEDULER_STATS
+  scheduler_stats_t stats;
+  unsigned long long depth_samples;
+  unsigned long long depth_sum;
+#endif
+};
+
+/**
+  The instance the entry points work on, kept per thread so that threads can
+  drive schedulers of their own; see scheduler_select(). A program with a
+  single scheduler never selects one and uses default_scheduler.
+*/
+static scheduler_t default_scheduler = { .target_latency = 8, .queue_limit = -1 };
+static __thread scheduler_t* sched = &default_scheduler;
+
+/**
+  Instrumentation. With SCHEDULER_STATS undefined the macros expand to
+  nothing, so the counters cost nothing in a normal build.
+*/
+#ifdef SCHEDULER_STATS
+#define STAT_INC(counter) (sched -> stats.counter++)
+#define STAT_ENTER() unsigned long long stat_start = read_cycles()
+#define STAT_LEAVE(entry) stat_leave(entry, stat_start)
+#define COMPARE(a, b) counted_compare(a, b)
+#else
+#define STAT_INC(counter) ((void)0)
+#define STAT_ENTER() ((void)0)
+#define STAT_LEAVE(entry) ((void)0)
+#define COMPARE(a, b) sched -> comp(a, b)
+#endif
+
+int check_idle_core();
+void decrease_remaining_time(scheduler_time_t time);
+int lowest_priority_job(void* job);
+static int place_new_job(job_t* job, scheduler_time_t time);
+static job_t* create_job(scheduler_id_t job_number, scheduler_time_t time, scheduler_time_t running_time, int priority, scheduler_time_t deadline);
+static scheduler_id_t dispatch_next(int core_id, scheduler_time_t time);
+static void admit_arrivals(job_t** arrivals, int count);
+
+#ifdef SCHEDULER_STATS
+static void stat_leave(entry_t entry, unsigned long long start)
+{
+  sched -> stats.cycles[entry] += read_cycles() - start;
+  sched -> stats.calls[entry]++;
+  if(sched -> queued_jobs > sched -> stats.max_queue_depth){
+    sched -> stats.max_queue_depth = sched -> queued_jobs;
+  }
+  sched -> depth_sum += sched -> queued_jobs;
+  sched -> depth_samples++;
+}
+
+/**
+  Counts comparator calls, then defers to the scheme's comparator.
+*/
+static int counted_compare(const void *a, const void *b)
+{
+  sched -> stats.comparisons++;
+  return sched -> comp(a, b);
+}
+#endif
+
+/**
+  Load weight of each nice level (-20..19), as used by the Linux CFS. Each
+  step changes the CPU share by roughly 10%, and nice 0 has a weight of 1024.
+*/
+static const int prio_to_weight[40] = {
+  88761, 71755, 56483, 46273, 36291,
+  29154, 23254, 18705, 14949, 11916,
+   9548,  7620,  6100,  4904,  3906,
+   3121,  2501,  1991,  1586,  1277,
+   1024,   820,   655,   526,   423,
+    335,   272,   215,   172,   137,
+    110,    87,    70,    56,    45,
+     36,    29,    23,    18,    15,
+};
+
+/**
+  Virtual runtime is kept in 1/1024ths of a time unit so that heavy jobs
+  still advance when they run for a single time unit.
+*/
+#define VRUNTIME_SHIFT 10
+#define NICE_0_WEIGHT 1024
+
+/**
+  The sign of a - b, for comparing times and job numbers, whose difference
+  does not fit the int a comparator returns.
+*/
+static int compare_values(long long a, long long b)
+{
+  return (a > b) - (a < b);
+}
+
+
+int comapreFCFS(const void *a, const void *b)
+{
+  job_t* job_a = (job_t*)a;
+  job_t* job_b = (job_t*)b;
+  if(job_a -> job_id == job_b -> job_id){
+    return 0;
+  }
+  return compare_values(job_a -> arrival_time, job_b -> arrival_time);
+}
+
+int compareSJF(const void *a, const void *b)
+{
+  job_t* job_a = (job_t*)a;
+  job_t* job_b = (job_t*)b;
+  if(job_a -> job_id == job_b -> job_id){
+    return 0;
+  }
+  int diff = compare_values(job_a -> remaining_time, job_b -> remaining_time);
+  if(diff == 0){
+    return compare_values(job_a -> arrival_time, job_b -> arrival_time);
+  }
+  else{
+    return diff;
+  }
+}
+
+int comparePRI(const void *a, const void *b)
+{
+  job_t* job_a = (job_t*)a;
+  job_t* job_b = (job_t*)b;
+  if(job_a -> job_id == job_b -> job_id){
+    return 0;
+  }
+  if(sched -> aging_interval > 0 && job_a -> aged_priority != job_b -> aged_priority){
+    return (job_a -> aged_priority < job_b -> aged_priority) ? -1 : 1;
+  }
+  int diff = job_a -> priority - job_b -> priority;
+  if(diff == 0){
+    return compare_values(job_a -> arrival_time, job_b -> arrival_time);
+  }
+  else{
+    return diff;
+  }
+}
+
+int compareRR(const void *a, const void *b)
+{
+  job_t* job_a = (job_t*)a;
+  job_t* job_b = (job_t*)b;
+  if(job_a -> job_id == job_b -> job_id){
+    return 0;
+  }
+  return 1;
+}
+
+int compareCFS(const void *a, const void *b)
+{
+  job_t* job_a = (job_t*)a;
+  job_t* job_b = (job_t*)b;
+  if(job_a -> vruntime != job_b -> vruntime){
+    return (job_a -> vruntime < job_b -> vruntime) ? -1 : 1;
+  }
+  if(job_a -> arrival_time != job_b -> arrival_time){
+    return compare_values(job_a -> arrival_time, job_b -> arrival_time);
+  }
+  return compare_values(job_a -> job_id, job_b -> job_id);
+}
+
+int compareEDF(const void *a, const void *b)
+{
+  job_t* job_a = (job_t*)a;
+  job_t* job_b = (job_t*)b;
+  if(job_a -> job_id == job_b -> job_id){
+    return 0;
+  }
+  // Jobs without a deadline sort after every job that has one
+  unsigned long long deadline_a = (unsigned long long)job_a -> deadline;
+  unsigned long long deadline_b = (unsigned long long)job_b -> deadline;
+  if(deadline_a != deadline_b){
+    return (deadline_a < deadline_b) ? -1 : 1;
+  }
+  if(job_a -> arrival_time != job_b -> arrival_time){
+    return compare_values(job_a -> arrival_time, job_b -> arrival_time);
+  }
+  return compare_values(job_a -> job_id, job_b -> job_id);
+}
+
+/**
+  The built-in schemes, indexed by scheme_t.
+*/
+static const scheduler_policy_ops builtin_policies[] = {
+  [FCFS]   = { .name = "fcfs",   .compare = comapreFCFS, .queue = QUEUE_LIST, .preemptive = 0, .response_is_wait = 1 },
+  [SJF]    = { .name = "sjf",    .compare = compareSJF,  .queue = QUEUE_LIST, .preemptive = 0, .response_is_wait = 1 },
+  [PSJF]   = { .name = "psjf",   .compare = compareSJF,  .queue = QUEUE_LIST, .preemptive = 1 },
+  [PRI]    = { .name = "pri",    .compare = comparePRI,  .queue = QUEUE_LIST, .preemptive = 0, .response_is_wait = 1 },
+  [PPRI]   = { .name = "ppri",   .compare = comparePRI,  .queue = QUEUE_LIST, .preemptive = 1 },
+  [RR]     = { .name = "rr",     .compare = compareRR,   .queue = QUEUE_LIST, .preemptive = 0 },
+  [CFS]    = { .name = "cfs",    .compare = compareCFS,  .queue = QUEUE_TREE, .preemptive = 0 },
+  [EDF]    = { .name = "edf",    .compare = compareEDF,  .queue = QUEUE_TREE, .preemptive = 0, .response_is_wait = 1 },
+  [PEDF]   = { .name = "pedf",   .compare = compareEDF,  .queue = QUEUE_TREE, .preemptive = 1 },
+  [STRIDE] = { .name = "stride", .compare = compareCFS,  .queue = QUEUE_HEAP, .preemptive = 0 },
+};
+
+/**
+  A job of a batch of arrivals, with its position in the batch.
+*/
+typedef struct _batch_entry_t{
+  job_t* job;
+  int index;
+} batch_entry_t;
+
+/**
+  Orders a batch of arrivals by the scheme's comparator and by position in
+  the batch for jobs the comparator does not separate.
+*/
+int compareBatch(const void *a, const void *b)
+{
+  const batch_entry_t* entry_a = (const batch_entry_t*)a;
+  const batch_entry_t* entry_b = (const batch_entry_t*)b;
+  int order = COMPARE(entry_a -> job, entry_b -> job);
+  if(order != 0){
+    return (order < 0) ? -1 : 1;
+  }
+  return entry_a -> index - entry_b -> index;
+}
+
+/**
+  Orders jobs by which admission control drops first: the lowest priority,
+  the latest arrival among equals.
+*/
+int compareDropLowest(const void *a, const void *b)
+{
+  const job_t* job_a = (const job_t*)a;
+  const job_t* job_b = (const job_t*)b;
+  if(job_a -> priority != job_b -> priority){
+    return job_b -> priority - job_a -> priority;
+  }
+  if(job_a -> arrival_time != job_b -> arrival_time){
+    return compare_values(job_b -> arrival_time, job_a -> arrival_time);
+  }
+  return compare_values(job_b -> job_id, job_a -> job_id);
+}
+
+/**
+  Orders jobs by which admission control drops first: the earliest arrival.
+*/
+int compareDropOldest(const void *a, const void *b)
+{
+  const job_t* job_a = (const job_t*)a;
+  const job_t* job_b = (const job_t*)b;
+  if(job_a -> arrival_time != job_b -> arrival_time){
+    return compare_values(job_a -> arrival_time, job_b -> arrival_time);
+  }
+  return compare_values(job_a -> job_id, job_b -> job_id);
+}
+
+/**
+  Orders the blocked jobs, which are looked up by job_id.
+*/
+int compareJobId(const void *a, const void *b)
+{
+  return compare_values(((const job_t*)a) -> job_id, ((const job_t*)b) -> job_id);
+}
+
+static int tracks_shed_order()
+{
+  return sched -> queue_limit >= 0 && sched -> admission != ADMIT_REJECT_NEW;
+}
+
+/**
+  The ready queue is a priqueue_t for the original schemes, a red-black tree
+  for CFS and EDF and a binary heap for STRIDE. The latter are meant for
+  large ready queues, where the linear insert of priqueue_offer() would
+  dominate.
+*/
+static void queue_offer(runqueue_t* rq, job_t* job)
+{
+  switch(sched -> queue_kind){
+    case QUEUE_TREE:
+      rbtree_insert(&rq -> tree, job);
+      break;
+    case QUEUE_HEAP:
+      heap_push(&rq -> heap, job);
+      break;
+    default:
+      priqueue_offer(&rq -> list, job);
+      break;
+  }
+  if(tracks_shed_order()){
+    rbtree_insert(&sched -> shed_order, job);
+  }
+  sched -> queued_jobs++;
+  STAT_INC(offers);
+}
+
+static job_t* queue_poll(runqueue_t* rq)
+{
+  job_t* job;
+  switch(sched -> queue_kind){
+    case QUEUE_TREE:
+      job = (job_t*)rbtree_poll_min(&rq -> tree);
+      break;
+    case QUEUE_HEAP:
+      job = (job_t*)heap_poll(&rq -> heap);
+      break;
+    default:
+      job = (job_t*)priqueue_poll(&rq -> list);
+      break;
+  }
+  if(job != NULL){
+    STAT_INC(polls);
+    sched -> queued_jobs--;
+    if(tracks_shed_order()){
+      rbtree_remove(&sched -> shed_order, job);
+    }
+    if(job -> vruntime > sched -> min_vruntime){
+      sched -> min_vruntime = job -> vruntime;
+    }
+  }
+  return job;
+}
+
+static int queue_size(runqueue_t* rq)
+{
+  switch(sched -> queue_kind){
+    case QUEUE_TREE:
+      return rbtree_size(&rq -> tree);
+    case QUEUE_HEAP:
+      return heap_size(&rq -> heap);
+    default:
+      return priqueue_size(&rq -> list);
+  }
+}
+
+static job_t* queue_at(runqueue_t* rq, int index)
+{
+  switch(sched -> queue_kind){
+    case QUEUE_TREE:
+      return (job_t*)rbtree_at(&rq -> tree, index);
+    case QUEUE_HEAP:
+      return (job_t*)heap_at(&rq -> heap, index);
+    default:
+      return (job_t*)priqueue_at(&rq -> list, index);
+  }
+}
+
+static runqueue_t* local_queue(int core_id)
+{
+  if(sched -> num_queues == 1){
+    return &sched -> runqueues[0];
+  }
+  return &sched -> runqueues[core_id];
+}
+
+/**
+  Removes and returns the job at index of a run queue. The heap has no order
+  beyond its top, so only the list and the tree support this.
+*/
+static job_t* queue_remove_at(runqueue_t* rq, int index)
+{
+  job_t* job;
+  if(sched -> queue_kind == QUEUE_TREE){
+    job = (job_t*)rbtree_at(&rq -> tree, index);
+    rbtree_remove(&rq -> tree, job);
+  }
+  else{
+    job = (job_t*)priqueue_remove_at(&rq -> list, index);
+  }
+  STAT_INC(polls);
+  sched -> queued_jobs--;
+  if(tracks_shed_order()){
+    rbtree_remove(&sched -> shed_order, job);
+  }
+  if(job -> vruntime > sched -> min_vruntime){
+    sched -> min_vruntime = job -> vruntime;
+  }
+  return job;
+}
+
+/**
+  Takes a job out of whichever ready queue holds it, for admission control.
+  shed_order is left to the caller.
+  @return 1 if the job was queued, 0 otherwise.
+*/
+static int queue_remove_job(job_t* job)
+{
+  int q;
+  for(q = 0; q < sched -> num_queues; q++){
+    runqueue_t* rq = &sched -> runqueues[q];
+    int removed;
+    switch(sched -> queue_kind){
+      case QUEUE_TREE:
+        removed = rbtree_remove(&rq -> tree, job);
+        break;
+      case QUEUE_HEAP:
+        removed = heap_remove(&rq -> heap, job);
+        break;
+      default:
+        removed = priqueue_remove(&rq -> list, job);
+        break;
+    }
+    if(removed){
+      sched -> queued_jobs--;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/**
+  Lets the policy's pick_next hook choose among the first jobs of rq.
+*/
+static job_t* queue_poll_policy(runqueue_t* rq, int core_id)
+{
+  const scheduler_job_t* queued[POLICY_PICK_WINDOW];
+  int count = (sched -> queue_kind == QUEUE_HEAP) ? 1 : POLICY_PICK_WINDOW;
+  if(count > queue_size(rq)){
+    count = queue_size(rq);
+  }
+  int i;
+  for(i = 0; i < count; i++){
+    queued[i] = queue_at(rq, i);
+  }
+  int index = sched -> policy -> pick_next(queued, count, core_id, sched -> current_time);
+  if(index <= 0 || index >= count){
+    return queue_poll(rq);
+  }
+  return queue_remove_at(rq, index);
+}
+
+/**
+  Puts a job that was running back in a ready queue.
+*/
+static void queue_requeue(runqueue_t* rq, job_t* job, scheduler_time_t time)
+{
+  if(sched -> policy -> enqueue != NULL){
+    sched -> policy -> enqueue(job, time);
+  }
+  queue_offer(rq, job);
+}
+
+/**
+  Polls the next job of rq to run on core_id. With an affinity window, a
+  head that last ran on another core is passed over for the first of the
+  next few jobs that last ran on core_id or never ran (and so has no warm
+  cache anywhere), trading a bounded amount of ordering for fewer
+  migrations. skip is never chosen that way; it is the job whose quantum
+  just expired on this core.
+*/
+static job_t* queue_poll_affine(runqueue_t* rq, int core_id, job_t* skip)
+{
+  if(sched -> policy -> pick_next != NULL){
+    return queue_poll_policy(rq, core_id);
+  }
+  job_t* head = queue_at(rq, 0);
+  if(sched -> affinity_window <= 1 || sched -> queue_kind == QUEUE_HEAP || head == NULL ||
+     head -> last_core == -1 || head -> last_core == core_id){
+    return queue_poll(rq);
+  }
+  int size = queue_size(rq);
+  int i;
+  for(i = 1; i < sched -> affinity_window && i < size; i++){
+    job_t* candidate = queue_at(rq, i);
+    if(candidate != skip && (candidate -> last_core == -1 || candidate -> last_core == core_id)){
+      return queue_remove_at(rq, i);
+    }
+  }
+  return queue_poll(rq);
+}
+
+/**
+  Load balancing for new jobs: the shortest run queue, lowest id first.
+*/
+static runqueue_t* placement_queue()
+{
+  int best = 0;
+  int i;
+  for(i = 1; i < sched -> num_queues; i++){
+    if(queue_size(&sched -> runqueues[i]) < queue_size(&sched -> runqueues[best])){
+      best = i;
+    }
+  }
+  return &sched -> runqueues[best];
+}
+
+/**
+  Picks the next job for core_id: the head of its own run queue, or, when
+  that is empty, the head of the busiest other run queue.
+*/
+static job_t* next_job_for(int core_id)
+{
+  runqueue_t* rq = local_queue(core_id);
+  if(queue_size(rq) > 0){
+    return queue_poll_affine(rq, core_id, NULL);
+  }
+  runqueue_t* busiest = NULL;
+  int i;
+  for(i = 0; i < sched -> num_queues; i++){
+    if(queue_size(&sched -> runqueues[i]) > 0 && (busiest == NULL || queue_size(&sched -> runqueues[i]) > queue_size(busiest))){
+      busiest = &sched -> runqueues[i];
+    }
+  }
+  if(busiest == NULL){
+    return NULL;
+  }
+  rq -> steals++;
+  return queue_poll(busiest);
+}
+
+static int job_class(int priority)
+{
+  if(priority < -20){
+    return 0;
+  }
+  if(priority > 19){
+    return NUM_CLASSES - 1;
+  }
+  return priority + 20;
+}
+
+/**
+  The non-preemptive schemes without a quantum report the waiting time as
+  the response time, since a job runs to completion from the moment it
+  first starts.
+*/
+static int response_is_wait()
+{
+  return sched -> policy -> response_is_wait;
+}
+
+static void record_metric(int priority, metric_t metric, scheduler_time_t latency)
+{
+  int class = job_class(priority);
+  unsigned long long value = (latency > 0) ? latency : 0;
+  if(sched -> class_latency[class][metric] == NULL){
+    sched -> class_latency[class][metric] = malloc(sizeof(histogram_t));
+    histogram_init(sched -> class_latency[class][metric]);
+  }
+  histogram_record(&sched -> latency[metric], value);
+  histogram_record(sched -> class_latency[class][metric], value);
+}
+
+static void record_latency(int priority, scheduler_time_t wait, scheduler_time_t turnaround, scheduler_time_t response)
+{
+  record_metric(priority, METRIC_WAITING, wait);
+  record_metric(priority, METRIC_TURNAROUND, turnaround);
+  record_metric(priority, METRIC_RESPONSE, response);
+}
+
+/**
+  Records the I/O response time of a job that gets a core for the first
+  time since its I/O completed.
+*/
+static void note_dispatch(job_t* job, scheduler_time_t time)
+{
+  if(job -> io != NULL && job -> io -> ready_time != -1){
+    record_metric(job -> priority, METRIC_IO_RESPONSE, time - job -> io -> ready_time);
+    job -> io -> ready_time = -1;
+  }
+}
+
+/**
+  Feeds the length of a finished CPU burst to the moving average used by
+  the adaptive quantum.
+*/
+static void update_burst_ewma(scheduler_time_t burst)
+{
+  if(sched -> burst_ewma == 0){
+    sched -> burst_ewma = burst << 3;
+  }
+  else{
+    sched -> burst_ewma += burst - (sched -> burst_ewma >> 3);
+  }
+}
+
+static int job_weight(int priority)
+{
+  return prio_to_weight[job_class(priority)];
+}
+
+/**
+  Frees a job and its I/O bookkeeping.
+*/
+static void free_job(job_t* job)
+{
+  free(job -> io);
+  free(job);
+}
+
+/**
+  Creates a scheduler instance, for programs that drive several schedulers
+  (e.g. one per node of a cluster). Every scheduler_* function works on the
+  instance selected in the calling thread with scheduler_select(), so the
+  usual sequence is create, select, scheduler_start_up(), the scheduling
+  calls, scheduler_clean_up() and destroy. Instances share nothing, so
+  threads may drive different instances at the same time.
+
+  @return a new instance, not started up yet, or NULL if out of memory.
+*/
+scheduler_t* scheduler_create()
+{
+  //the submission ring aligns scheduler_t to a cache line, which calloc()
+  //does not promise; aligned_alloc() needs a multiple of the alignment
+  size_t alignment = _Alignof(scheduler_t);
+  size_t size = (sizeof(scheduler_t) + alignment - 1) / alignment * alignment;
+  scheduler_t* scheduler = aligned_alloc(alignment, size);
+  if(scheduler == NULL){
+    return NULL;
+  }
+  memset(scheduler, 0, size);
+  scheduler -> target_latency = 8;
+  return scheduler;
+}
+
+
+/**
+  Makes the calling thread's scheduler_* calls work on the given instance.
+
+  @param scheduler an instance from scheduler_create(), or NULL for the
+  default instance used by programs with a single scheduler.
+*/
+void scheduler_select(scheduler_t *scheduler)
+{
+  sched = (scheduler != NULL) ? scheduler : &default_scheduler;
+}
+
+
+/**
+  Frees an instance from scheduler_create(), after scheduler_clean_up() was
+  called on it. A thread that had it selected goes back to the default
+  instance.
+
+  @param scheduler the instance to free.
+*/
+void scheduler_destroy(scheduler_t *scheduler)
+{
+  if(sched == scheduler){
+    sched = &default_scheduler;
+  }
+  free(scheduler);
+}
+
+
+/**
+  Initalizes the scheduler.
+ 
+  Assumptions:
+    - You may assume this will be the first scheduler function called.
+    - You may assume this function will be called once once.
+    - You may assume that cores is a positive, non-zero number.
+    - You may assume that scheme is a valid scheduling scheme.
+
+  @param cores the number of cores that is available by the scheduler. These cores will be known as core(id=0), core(id=1), ..., core(id=cores-1).
+  @param scheme  the scheduling scheme that should be used, one of the ten values of scheme_t. A policy of
+  your own, or one from scheduler_load_policy(), is started with scheduler_start_up_policy() instead.
+*/
+void scheduler_start_up(int cores, scheme_t scheme)
+{
+  scheduler_start_up_policy(cores, scheduler_builtin_policy(scheme));
+}
+
+
+/**
+  Returns the table of a built-in scheme, e.g. to start from it when writing
+  a policy that only changes some hooks.
+
+  @param scheme one of the values of scheme_t.
+  @return the scheme's policy.
+ */
+const scheduler_policy_ops* scheduler_builtin_policy(scheme_t scheme)
+{
+  return &builtin_policies[scheme];
+}
+
+
+/**
+  Loads a policy from a shared object, which must define a
+  scheduler_policy_ops named SCHEDULER_POLICY_SYMBOL. The object stays
+  loaded until scheduler_clean_up(). Call before
+  scheduler_start_up_policy(), at most once.
+
+  @param path the path of the shared object, as given to dlopen().
+  @return the policy, or NULL (with a message on stderr) if it could not be loaded.
+ */
+const scheduler_policy_ops* scheduler_load_policy(const char *path)
+{
+  void* handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+  if(handle == NULL){
+    fprintf(stderr, "%s\n", dlerror());
+    return NULL;
+  }
+  const scheduler_policy_ops* ops = dlsym(handle, SCHEDULER_POLICY_SYMBOL);
+  if(ops == NULL || ops -> compare == NULL){
+    fprintf(stderr, "%s does not define a " SCHEDULER_POLICY_SYMBOL " with a comparator.\n", path);
+    dlclose(handle);
+    return NULL;
+  }
+  sched -> policy_handle = handle;
+  return ops;
+}
+
+
+/**
+  Initalizes the scheduler with a policy of its own, either a built-in one
+  or one returned by scheduler_load_policy(). The same assumptions as for
+  scheduler_start_up() apply.
+
+  @param cores the number of cores that is available by the scheduler.
+  @param ops the scheduling policy, which must outlive the scheduler.
+*/
+void scheduler_start_up_policy(int cores, const scheduler_policy_ops *ops)
+{
+  sched -> wait_time = 0;
+  sched -> turnaround_time = 0;
+  sched -> response_time = 0;
+  sched -> num_jobs = 0;
+  sched -> arrived_jobs = 0;
+  sched -> current_time = 0;
+  sched -> min_vruntime = 0;
+  sched -> queued_jobs = 0;
+  sched -> affinity_window = 0;
+  sched -> aging_interval = 0;
+  sched -> quantum_floor = 0;
+  sched -> core_speed = NULL;
+  sched -> core_credit = NULL;
+  sched -> burst_ewma = 0;
+  sched -> num_queues = 1;
+  sched -> runnable_tickets = 0;
+  sched -> contended_cpu_time = 0;
+  memset(sched -> class_tickets, 0, sizeof(sched -> class_tickets));
+  memset(sched -> class_cpu_time, 0, sizeof(sched -> class_cpu_time));
+  memset(sched -> class_entitled_time, 0, sizeof(sched -> class_entitled_time));
+  sched -> deadline_jobs = 0;
+  sched -> deadline_misses = 0;
+  sched -> queue_limit = -1;
+  sched -> admission = ADMIT_REJECT_NEW;
+  sched -> rejected_jobs = 0;
+  sched -> dropped_jobs = 0;
+  sched -> shed_ids = NULL;
+  sched -> shed_pending = 0;
+  sched -> shed_capacity = 0;
+  histogram_init(&sched -> lateness_early);
+  histogram_init(&sched -> lateness_late);
+  memset(sched -> class_latency, 0, sizeof(sched -> class_latency));
+  sched -> num_cores = cores;
+  sched -> core_used = malloc(sizeof(job_t) * cores);
+  sched -> core_stalled = malloc(sizeof(scheduler_time_t) * cores);
+  int i = 0;
+
+  for(i = 0; i < NUM_METRICS; i++){
+    histogram_init(&sched -> latency[i]);
+  }
+  i = 0;
+
+  while(i < cores){
+    sched -> core_used[i] = 0;
+    sched -> core_stalled[i] = 0;
+    i++;
+  }
+  rbtree_init(&sched -> blocked, compareJobId);
+  sched -> policy = ops;
+  sched -> comp = ops -> compare;
+  //a batch of arrivals is only sorted under a comparator that orders jobs
+  job_t probe_a, probe_b;
+  memset(&probe_a, 0, sizeof(job_t));
+  memset(&probe_b, 0, sizeof(job_t));
+  probe_b.job_id = 1;
+  sched -> comp_orders = !(sched -> comp(&probe_a, &probe_b) > 0 && sched -> comp(&probe_b, &probe_a) > 0);
+  sched -> preemptive = ops -> preemptive;
+  sched -> queue_kind = ops -> queue;
+  int (*queue_comp)(const void *, const void *) = sched -> comp;
+#ifdef SCHEDULER_STATS
+  memset(&sched -> stats, 0, sizeof(sched -> stats));
+  sched -> depth_samples = 0;
+  sched -> depth_sum = 0;
+  queue_comp = counted_compare;
+#endif
+  sched -> runqueues = malloc(sizeof(runqueue_t) * cores);
+  for(i = 0; i < cores; i++){
+    priqueue_init(&sched -> runqueues[i].list, queue_comp);
+    rbtree_init(&sched -> runqueues[i].tree, queue_comp);
+    heap_init(&sched -> runqueues[i].heap, queue_comp);
+    sched -> runqueues[i].length_time = 0;
+    sched -> runqueues[i].steals = 0;
+  }
+}
+
+
+/**
+  Gives every core its own run queue instead of sharing one global queue.
+  New jobs that cannot run right away go to the shortest run queue, a
+  preempted or expired job goes back to the queue of its core, and a core
+  whose queue is empty steals the head of the busiest other queue. Call
+  after scheduler_start_up() and before the first job arrives.
+
+  @param enabled non-zero to use one run queue per core.
+*/
+void scheduler_set_per_core_queues(int enabled)
+{
+  sched -> num_queues = enabled ? sched -> num_cores : 1;
+}
+
+
+/**
+  Makes the scheduler prefer to run jobs on the core they last ran on: when
+  a core picks its next job and the head of the queue last ran elsewhere,
+  the first of the next window-1 jobs that last ran on this core (or never
+  ran) is taken instead. Has no effect with the STRIDE heap. Call after
+  scheduler_start_up() and before the first job arrives.
+
+  @param window how many jobs from the head of the queue to consider, 0 or
+  1 to always take the head.
+*/
+void scheduler_set_affinity_window(int window)
+{
+  sched -> affinity_window = window;
+}
+
+
+/**
+  Ages waiting jobs under PRI and PPRI: a job's effective priority improves
+  by one for every interval time units it has waited since it was last
+  queued, so low priority jobs cannot starve. Ordering by priority minus
+  waiting credit is the same as ordering by priority * interval plus the
+  time the job was queued, so every job keeps one fixed key while it waits
+  and the queue is never reordered; only the keys of the running jobs are
+  refreshed, as running earns no credit. Has no effect on other schemes.
+  Call after scheduler_start_up() and before the first job arrives.
+
+  @param interval time units of waiting per priority level, 0 to disable.
+*/
+void scheduler_set_aging(int interval)
+{
+  sched -> aging_interval = interval;
+}
+
+
+/**
+  Gives the cores different speeds. Idle cores are then filled fastest
+  first (lowest id among equals), so the best job of a batch of arrivals
+  gets the fastest core, and under PSJF an arriving job preempts the job
+  that would take longest to finish where it runs (remaining time divided
+  by the core's speed) instead of the one with the most remaining time.
+  Call after scheduler_start_up() and before the first job arrives.
+
+  @param speeds the speed of each core, in SCHEDULER_SPEED_UNITs; each
+  positive.
+*/
+void scheduler_set_core_speeds(const int *speeds)
+{
+  int i;
+  sched -> core_speed = malloc(sizeof(int) * sched -> num_cores);
+  sched -> core_credit = malloc(sizeof(int) * sched -> num_cores);
+  for(i = 0; i < sched -> num_cores; i++){
+    sched -> core_speed[i] = speeds[i];
+    sched -> core_credit[i] = 0;
+  }
+}
+
+
+/**
+  Bounds the ready queue at max_depth waiting jobs, on top of the one
+  running on each core. When a job arrives at a full scheduler, policy
+  decides what is shed: ADMIT_REJECT_NEW turns the arrival away, and
+  ADMIT_DROP_LOWEST and ADMIT_DROP_OLDEST drop the queued job of lowest
+  priority or earliest arrival (the arrival itself if it comes first in
+  that order). Running jobs are never shed. scheduler_new_job() returns
+  SCHEDULER_SHED for an arrival that was turned away; dropped queued jobs
+  are collected with scheduler_shed_job(). Only finished jobs count in the
+  averages and latency distributions. A job returning from I/O is always
+  readmitted. Call after scheduler_start_up() and before the first job
+  arrives.
+
+  @param max_depth the most jobs in the ready queue(s), -1 for no limit.
+  @param policy what to shed when the scheduler is full.
+*/
+void scheduler_set_queue_limit(int max_depth, admission_t policy)
+{
+  sched -> queue_limit = max_depth;
+  sched -> admission = policy;
+  if(policy == ADMIT_DROP_LOWEST){
+    rbtree_init(&sched -> shed_order, compareDropLowest);
+  }
+  else if(policy == ADMIT_DROP_OLDEST){
+    rbtree_init(&sched -> shed_order, compareDropOldest);
+  }
+}
+
+
+/**
+  Sets the target latency used by CFS: the period in which every runnable
+  job should get to run once. Call after scheduler_start_up() and before the
+  first job arrives.
+
+  @param latency the target latency in time units, a positive number.
+*/
+void scheduler_set_target_latency(int latency)
+{
+  sched -> target_latency = latency;
+}
+
+
+/**
+  Makes the RR quantum adaptive: each dispatch runs for the target latency
+  divided between the runnable jobs, so that every job gets the core again
+  within about one latency. When the recent jobs needed at most twice that
+  (an exponential moving average of their running times, weight 1/8) the
+  quantum is stretched to it, so that a typical job finishes instead of
+  being switched out just before the end. The quantum never drops below
+  min_quantum, which caps the rate of context switches under heavy load.
+  The simulator reads the quantum with scheduler_time_slice(). Call after
+  scheduler_start_up() and before the first job arrives.
+
+  @param latency the target latency in time units, a positive number.
+  @param min_quantum the smallest quantum, a positive number.
+*/
+void scheduler_set_adaptive_quantum(int latency, int min_quantum)
+{
+  sched -> target_latency = latency;
+  sched -> quantum_floor = min_quantum;
+}
+
+
+/**
+  When the scheme is CFS, or RR with an adaptive quantum, returns the
+  quantum the job dispatched on core_id should run for before
+  scheduler_quantum_expired() is called. Under CFS it is the target latency
+  divided evenly between all runnable jobs, but at least one time unit;
+  see scheduler_set_adaptive_quantum() for RR.
+
+  @param core_id the zero-based index of the core that was just dispatched.
+  @return the length of the time slice, in time units.
+*/
+scheduler_time_t scheduler_time_slice(int core_id)
+{
+  STAT_ENTER();
+  long long runnable;
+  scheduler_time_t slice;
+  int i = 0;
+  if(sched -> num_queues > 1){
+    runnable = queue_size(local_queue(core_id)) + (sched -> core_used[core_id] != 0);
+  }
+  else{
+    runnable = sched -> queued_jobs;
+    while(i < sched -> num_cores){
+      if(sched -> core_used[i] != 0){
+        runnable++;
+      }
+      i++;
+    }
+  }
+  if(runnable == 0 || sched -> target_latency / runnable < 1){
+    slice = 1;
+  }
+  else{
+    slice = sched -> target_latency / runnable;
+  }
+  if(sched -> quantum_floor > 0){
+    scheduler_time_t burst = (sched -> burst_ewma + 7) >> 3;
+    if(burst > slice && burst <= 2 * slice){
+      slice = burst;
+    }
+    if(slice < sched -> quantum_floor){
+      slice = sched -> quantum_floor;
+    }
+  }
+  STAT_LEAVE(ENTRY_TIME_SLICE);
+  return slice;
+}
+
+
+/**
+  Called when a new job arrives.
+  If multiple cores are idle, the job should be assigned to the core with the
+  lowest id.
+  If the job arriving should be scheduled to run during the next
+  time cycle, return the zero-based index of the core the job should be
+  scheduled on. If another job is already running on the core specified,
+  this will preempt the currently running job.
+  Assumption:
+    - You may assume that every job wil have a unique arrival time.
+
+  @param job_number a globally unique identification number of the job arriving.
+  @param time the current time of the simulator.
+  @param running_time the total number of time units this job will run before it will be finished.
+  @param priority the priority of the job. (The lower the value, the higher the priority.)
+  @return index of core job should be scheduled on
+  @return -1 if no scheduling changes should be made. 
+ 
+ */
+int scheduler_new_job(scheduler_id_t job_number, scheduler_time_t time, scheduler_time_t running_time, int priority)
+{
+  return scheduler_new_job_deadline(job_number, time, running_time, priority, -1);
+}
+
+
+/**
+  Called when a new job with a completion deadline arrives. Behaves exactly
+  like scheduler_new_job(); the deadline orders the ready queue under EDF and
+  PEDF and is used for the deadline statistics under every scheme.
+
+  @param job_number a globally unique identification number of the job arriving.
+  @param time the current time of the simulator.
+  @param running_time the total number of time units this job will run before it will be finished.
+  @param priority the priority of the job. (The lower the value, the higher the priority.)
+  @param deadline the absolute time by which the job should finish, or -1 if it has none.
+  @return index of core job should be scheduled on
+  @return -1 if no scheduling changes should be made.
+ */
+int scheduler_new_job_deadline(scheduler_id_t job_number, scheduler_time_t time, scheduler_time_t running_time, int priority, scheduler_time_t deadline)
+{
+  STAT_ENTER();
+  decrease_remaining_time(time);
+  job_t* job = create_job(job_number, time, running_time, priority, deadline);
+  admit_arrivals(&job, 1);
+  if(job == NULL){
+    STAT_LEAVE(ENTRY_NEW_JOB);
+    return SCHEDULER_SHED;
+  }
+  int core = place_new_job(job, time);
+  STAT_LEAVE(ENTRY_NEW_JOB);
+  return core;
+}
+
+
+/**
+  Called when several jobs arrive in the same time unit. The result is a
+  valid schedule for the whole batch: each core is given to at most one of
+  the arriving jobs, and a job that only ran for the sequence of
+  scheduler_new_job() calls would have been preempted again within this
+  time unit is simply queued. Idle cores go to the best arriving jobs (in
+  the order of the scheme; in the order of arrivals for equal jobs), and
+  preemptions are decided once for the whole batch. In a global list queue
+  the rest of the batch is merged in one pass, so the call costs
+  O(k log k + n) for k arrivals and n queued jobs.
+
+  @param time the current time of the simulator.
+  @param arrivals the arriving jobs.
+  @param count the number of arriving jobs.
+  @param cores_out for each arriving job, the index of the core it should be
+  scheduled on (preempting the job running there), -1 if it was queued, or
+  SCHEDULER_SHED if admission control turned it away.
+ */
+void scheduler_new_jobs(scheduler_time_t time, const scheduler_arrival_t *arrivals, int count, int *cores_out)
+{
+  STAT_ENTER();
+  decrease_remaining_time(time);
+
+  batch_entry_t* batch = malloc(sizeof(batch_entry_t) * count);
+  job_t** arriving = malloc(sizeof(job_t*) * count);
+  int* batch_on_core = malloc(sizeof(int) * sched -> num_cores);
+  int i;
+  for(i = 0; i < count; i++){
+    arriving[i] = create_job(arrivals[i].job_number, time, arrivals[i].running_time, arrivals[i].priority, arrivals[i].deadline);
+  }
+  admit_arrivals(arriving, count);
+  int admitted = 0;
+  for(i = 0; i < count; i++){
+    if(arriving[i] == NULL){
+      cores_out[i] = SCHEDULER_SHED;
+      continue;
+    }
+    batch[admitted].job = arriving[i];
+    batch[admitted].index = i;
+    admitted++;
+    cores_out[i] = -1;
+  }
+  count = admitted;
+  free(arriving);
+  for(i = 0; i < sched -> num_cores; i++){
+    batch_on_core[i] = -1;
+  }
+  if(sched -> comp_orders){
+    qsort(batch, count, sizeof(batch_entry_t), compareBatch);
+  }
+
+  //the best arriving jobs take the idle cores
+  int next = 0;
+  int core = check_idle_core();
+  while(core != -1 && next < count){
+    job_t* job = batch[next].job;
+    sched -> core_used[core] = job;
+    job -> start_time = time;
+    job -> last_core = core;
+    cores_out[batch[next].index] = core;
+    batch_on_core[core] = batch[next].index;
+    next++;
+    core = check_idle_core();
+  }
+
+  //the batch is sorted, so once a job cannot preempt, the rest cannot either
+  while(sched -> preemptive && next < count){
+    job_t* job = batch[next].job;
+    core = lowest_priority_job(job);
+    if(core == -1){
+      break;
+    }
+    job_t* temp = sched -> core_used[core];
+    if(time == temp -> start_time){
+      temp -> start_time = -1;
+    }
+    if(batch_on_core[core] != -1){
+      cores_out[batch_on_core[core]] = -1;
+    }
+    job -> start_time = time;
+    job -> last_core = core;
+    sched -> core_used[core] = job;
+    queue_requeue(local_queue(core), temp, time);
+    STAT_INC(preemptions);
+    cores_out[batch[next].index] = core;
+    batch_on_core[core] = batch[next].index;
+    next++;
+  }
+
+  if(sched -> queue_kind == QUEUE_LIST && sched -> num_queues == 1){
+    void** rest = malloc(sizeof(void*) * (count - next + 1));
+    for(i = next; i < count; i++){
+      rest[i - next] = batch[i].job;
+    }
+    priqueue_offer_sorted(&sched -> runqueues[0].list, rest, count - next);
+    sched -> queued_jobs += count - next;
+    if(tracks_shed_order()){
+      for(i = next; i < count; i++){
+        rbtree_insert(&sched -> shed_order, batch[i].job);
+      }
+    }
+#ifdef SCHEDULER_STATS
+    sched -> stats.offers += count - next;
+#endif
+    free(rest);
+  }
+  else{
+    for(i = next; i < count; i++){
+      queue_offer(placement_queue(), batch[i].job);
+    }
+  }
+
+  free(batch_on_core);
+  free(batch);
+  STAT_LEAVE(ENTRY_NEW_JOBS);
+}
+
+
+/**
+  Sets up a lock-free submission ring of capacity arrivals (rounded up to a
+  power of two), for programs whose jobs arrive on many threads while one
+  thread drives the scheduler. Producers hand their arrivals to
+  scheduler_submit_job() without blocking each other, and the scheduler
+  thread moves them into the ready queue in batches with
+  scheduler_drain_submissions(). Call after scheduler_start_up() and before
+  the first job arrives.
+
+  @param capacity the most arrivals waiting in the ring, a positive number.
+  @return 0 on success, -1 if the ring could not be allocated.
+*/
+int scheduler_set_submission_ring(int capacity)
+{
+  if(mpsc_init(&sched -> submissions, capacity, sizeof(scheduler_arrival_t)) != 0){
+    return -1;
+  }
+  sched -> submission_capacity = sched -> submissions.mask + 1;
+  sched -> submission_batch = malloc(sizeof(scheduler_arrival_t) * sched -> submission_capacity);
+  return 0;
+}
+
+
+/**
+  Submits an arriving job from any thread, without taking a lock. This is
+  the only entry point that may be called while another thread drives the
+  scheduler; a producer thread that did not call scheduler_select() submits
+  to the default instance. The job arrives at the time of the
+  scheduler_drain_submissions() call that collects it.
+
+  @param job_number a globally unique identification number of the job.
+  @param running_time the total number of time units this job will run.
+  @param priority the priority of the job (lower value, higher priority).
+  @param deadline the absolute deadline, or -1 for none.
+  @return 1 if the job was submitted, 0 if the ring is full and the caller
+  should retry once the scheduler thread has drained it.
+*/
+int scheduler_submit_job(scheduler_id_t job_number, scheduler_time_t running_time, int priority, scheduler_time_t deadline)
+{
+  scheduler_arrival_t arrival = { job_number, running_time, priority, deadline };
+  return mpsc_offer(&sched -> submissions, &arrival);
+}
+
+
+/**
+  Called by the thread driving the scheduler to collect up to max submitted
+  jobs, oldest first, which arrive as one scheduler_new_jobs() batch.
+
+  @param time the current time of the simulator.
+  @param max the most jobs to collect; jobs_out and cores_out have room for
+  that many.
+  @param jobs_out the job numbers of the collected jobs.
+  @param cores_out for each collected job, as from scheduler_new_jobs().
+  @return the number of jobs collected, 0 if none were waiting.
+*/
+int scheduler_drain_submissions(scheduler_time_t time, int max, scheduler_id_t *jobs_out, int *cores_out)
+{
+  if(max > sched -> submission_capacity){
+    max = sched -> submission_capacity;
+  }
+  int count = mpsc_drain(&sched -> submissions, sched -> submission_batch, max);
+  if(count == 0){
+    return 0;
+  }
+  scheduler_new_jobs(time, sched -> submission_batch, count, cores_out);
+  int i;
+  for(i = 0; i < count; i++){
+    jobs_out[i] = sched -> submission_batch[i].job_number;
+  }
+  return count;
+}
+
+
+/**
+  Allocates the scheduler's record of an arriving job.
+*/
+static job_t* create_job(scheduler_id_t job_number, scheduler_time_t time, scheduler_time_t running_time, int priority, scheduler_time_t deadline)
+{
+  job_t* job = malloc(sizeof(job_t));
+  job -> job_id = job_number;
+  job -> arrival_time = time;
+  job -> running_time = running_time;
+  job -> priority = priority;
+  job -> remaining_time = running_time;
+  job -> run_ticks = 0;
+  job -> start_time = -1;
+  job -> deadline = deadline;
+  job -> last_core = -1;
+  job -> vruntime = sched -> min_vruntime;
+  job -> aged_priority = (long long)priority * sched -> aging_interval + time;
+  job -> io = NULL;
+  sched -> arrived_jobs++;
+  sched -> runnable_tickets += job_weight(priority);
+  sched -> class_tickets[job_class(priority)] += job_weight(priority);
+  if(sched -> policy -> enqueue != NULL){
+    sched -> policy -> enqueue(job, time);
+  }
+  return job;
+}
+
+
+/**
+  Gives the core freed by a finished or blocked job to the next job.
+  @return the job_number of that job, -1 if the core stays idle.
+*/
+static scheduler_id_t dispatch_next(int core_id, scheduler_time_t time)
+{
+  job_t* next_job = next_job_for(core_id);
+  if(next_job == NULL){
+    return -1;
+  }
+  if(next_job -> start_time == -1){
+    next_job -> start_time = time;
+  }
+  next_job -> last_core = core_id;
+  note_dispatch(next_job, time);
+  sched -> core_used[core_id] = next_job;
+  return next_job -> job_id;
+}
+
+
+/**
+  Frees a job that admission control shed, either an arrival that is turned
+  away or a job dropped from the ready queue.
+*/
+static void shed_job(job_t* job, int queued)
+{
+  sched -> runnable_tickets -= job_weight(job -> priority);
+  sched -> class_tickets[job_class(job -> priority)] -= job_weight(job -> priority);
+  if(queued){
+    if(sched -> shed_pending == sched -> shed_capacity){
+      sched -> shed_capacity = (sched -> shed_capacity == 0) ? 16 : sched -> shed_capacity * 2;
+      sched -> shed_ids = realloc(sched -> shed_ids, sizeof(scheduler_id_t) * sched -> shed_capacity);
+    }
+    sched -> shed_ids[sched -> shed_pending++] = job -> job_id;
+    sched -> dropped_jobs++;
+  }
+  else{
+    sched -> rejected_jobs++;
+  }
+  free_job(job);
+}
+
+
+/**
+  Admission control for the jobs arriving in one call (count of them, in
+  the order they arrived), before any of them is placed. Each admitted
+  arrival adds one job to those running or queued (it takes an idle core, is
+  queued, or is queued instead of the job it preempts), so jobs are shed
+  until there are at most num_cores + queue_limit: the last arrivals under
+  ADMIT_REJECT_NEW, otherwise the first in the drop order among the queued
+  jobs and the arrivals. Arrivals that are shed are set to NULL.
+*/
+static void admit_arrivals(job_t** arrivals, int count)
+{
+  if(sched -> queue_limit < 0){
+    return;
+  }
+  long long excess = sched -> queued_jobs + count - sched -> num_cores - sched -> queue_limit;
+  int i;
+  for(i = 0; i < sched -> num_cores; i++){
+    if(sched -> core_used[i] != 0){
+      excess++;
+    }
+  }
+  if(excess <= 0){
+    return;
+  }
+
+  if(sched -> admission == ADMIT_REJECT_NEW){
+    for(i = count - 1; i >= 0 && excess > 0; i--, excess--){
+      shed_job(arrivals[i], 0);
+      arrivals[i] = NULL;
+    }
+    return;
+  }
+
+  //arrivals chosen as victims are marked in shed[] and shed below
+  int* shed = malloc(sizeof(int) * count);
+  for(i = 0; i < count; i++){
+    shed[i] = 0;
+    rbtree_insert(&sched -> shed_order, arrivals[i]);
+  }
+  for(; excess > 0; excess--){
+    job_t* victim = (job_t*)rbtree_poll_min(&sched -> shed_order);
+    if(queue_remove_job(victim)){
+      shed_job(victim, 1);
+      continue;
+    }
+    for(i = 0; arrivals[i] != victim; i++);
+    shed[i] = 1;
+  }
+  for(i = 0; i < count; i++){
+    if(shed[i]){
+      shed_job(arrivals[i], 0);
+      arrivals[i] = NULL;
+    }
+    else{
+      rbtree_remove(&sched -> shed_order, arrivals[i]);
+    }
+  }
+  free(shed);
+}
 
-  You may need to define some global variables or a struct to store your job queue elements. 
+
+/**
+  Puts a new job on an idle core, on the core of the job it preempts, or in
+  a ready queue.
+  @return index of core job should be scheduled on, -1 if it was queued.
 */
+static int place_new_job(job_t* job, scheduler_time_t time)
+{
+  int core = check_idle_core();
+  if(core != -1){
+    sched -> core_used[core] = job;
+    if(job -> start_time == -1){
+      job -> start_time = time;
+    }
+    job -> last_core = core;
+    note_dispatch(job, time);
+    return core;
+  }
+
+  if(sched -> preemptive){
+    core = lowest_priority_job(job);
+    if(core > -1){
+      job_t* temp = sched -> core_used[core];
+      if(time == temp -> start_time){
+        temp -> start_time = -1;
+      }
+      if(job -> start_time == -1){
+        job -> start_time = time;
+      }
+      job -> last_core = core;
+      note_dispatch(job, time);
+      sched -> core_used[core] = job;
+      queue_requeue(local_queue(core), temp, time);
+      STAT_INC(preemptions);
+      return core;
+    }
+  }
+  queue_offer(placement_queue(), job);
+	return -1;
+}
+
+
+/**
+  Called when a job has completed execution.
+ 
+  The core_id, job_number and time parameters are provided for convenience. You may be able to calculate the values with your own data structure.
+  If any job should be scheduled to run on the core free'd up by the
+  finished job, return the job_number of the job that should be scheduled to
+  run on core core_id.
+ 
+  @param core_id the zero-based index of the core where the job was located.
+  @param job_number a globally unique identification number of the job.
+  @param time the current time of the simulator.
+  @return job_number of the job that should be scheduled to run on core core_id
+  @return -1 if core should remain idle.
+ */
+scheduler_id_t scheduler_job_finished(int core_id, scheduler_id_t job_number, scheduler_time_t time)
+{
+  STAT_ENTER();
+  scheduler_id_t next_job_id = -1;
+  decrease_remaining_time(time);
+  job_t* finished_job = sched -> core_used[core_id];
+  sched -> num_jobs++;
+  //on cores of different speeds a job does not take running_time to run
+  job_io_t* io = finished_job -> io;
+  scheduler_time_t job_wait = time - finished_job -> arrival_time - (io != NULL ? io -> io_time : 0) - (sched -> core_speed != NULL ? finished_job -> run_ticks : finished_job -> running_time);
+  scheduler_time_t job_turnaround = time - finished_job -> arrival_time;
+  scheduler_time_t job_response = response_is_wait() ? job_wait : finished_job -> start_time - finished_job -> arrival_time;
+  sched -> wait_time += job_wait;
+  sched -> turnaround_time += job_turnaround;
+  update_burst_ewma(io != NULL ? io -> burst_time : finished_job -> running_time);
+  record_latency(finished_job -> priority, job_wait, job_turnaround, job_response);
+  sched -> runnable_tickets -= job_weight(finished_job -> priority);
+  sched -> class_tickets[job_class(finished_job -> priority)] -= job_weight(finished_job -> priority);
+  sched -> response_time += (finished_job -> start_time - finished_job -> arrival_time);
+  if(finished_job -> deadline >= 0){
+    scheduler_time_t job_lateness = time - finished_job -> deadline;
+    if(job_lateness > 0){
+      sched -> deadline_misses++;
+      histogram_record(&sched -> lateness_late, job_lateness);
+    }
+    else{
+      histogram_record(&sched -> lateness_early, -job_lateness);
+    }
+    sched -> deadline_jobs++;
+  }
+  free_job(sched -> core_used[core_id]);
+  sched -> core_used[core_id] = 0;
+  next_job_id = dispatch_next(core_id, time);
+  STAT_LEAVE(ENTRY_JOB_FINISHED);
+  return next_job_id;
+}
+
+
+/**
+  Called when the job running on core_id finishes a CPU burst and blocks
+  for I/O. The job leaves the core and does not compete for one until
+  scheduler_job_unblocked(); it still counts as in flight. Like
+  scheduler_job_finished(), returns the job to run next on the core.
+
+  @param core_id the zero-based index of the core where the job was located.
+  @param job_number a globally unique identification number of the job.
+  @param time the current time of the simulator.
+  @return job_number of the job that should be scheduled to run on core core_id
+  @return -1 if core should remain idle.
+ */
+scheduler_id_t scheduler_job_blocked(int core_id, scheduler_id_t job_number, scheduler_time_t time)
+{
+  STAT_ENTER();
+  decrease_remaining_time(time);
+  job_t* blocked_job = sched -> core_used[core_id];
+  if(blocked_job -> io == NULL){
+    blocked_job -> io = malloc(sizeof(job_io_t));
+    blocked_job -> io -> burst_time = blocked_job -> running_time;
+    blocked_job -> io -> io_time = 0;
+    blocked_job -> io -> ready_time = -1;
+  }
+  update_burst_ewma(blocked_job -> io -> burst_time);
+  sched -> runnable_tickets -= job_weight(blocked_job -> priority);
+  sched -> class_tickets[job_class(blocked_job -> priority)] -= job_weight(blocked_job -> priority);
+  blocked_job -> io -> blocked_time = time;
+  rbtree_insert(&sched -> blocked, blocked_job);
+  sched -> core_used[core_id] = 0;
+  scheduler_id_t next_job_id = dispatch_next(core_id, time);
+  STAT_LEAVE(ENTRY_JOB_BLOCKED);
+  return next_job_id;
+}
+
+
+/**
+  Called when the I/O of a blocked job completes and the job needs the CPU
+  for another running_time time units. The job competes for a core like a
+  new arrival: it may take an idle core or preempt a job. Under CFS and
+  STRIDE its virtual time is first raised to the smallest one in the
+  queue, so that time spent blocked does not turn into a long monopoly of
+  a core.
+
+  @param job_number the job given to scheduler_job_blocked().
+  @param time the current time of the simulator.
+  @param running_time the length of the job's next CPU burst.
+  @return index of core job should be scheduled on
+  @return -1 if no scheduling changes should be made.
+ */
+int scheduler_job_unblocked(scheduler_id_t job_number, scheduler_time_t time, scheduler_time_t running_time)
+{
+  STAT_ENTER();
+  decrease_remaining_time(time);
+  job_t key;
+  key.job_id = job_number;
+  job_t* job = (job_t*)rbtree_find(&sched -> blocked, &key);
+  if(job == NULL){
+    STAT_LEAVE(ENTRY_JOB_UNBLOCKED);
+    return -1;
+  }
+  rbtree_remove(&sched -> blocked, job);
+  job -> io -> io_time += time - job -> io -> blocked_time;
+  job -> io -> ready_time = time;
+  job -> io -> burst_time = running_time;
+  job -> remaining_time = running_time;
+  job -> running_time += running_time;
+  if(job -> vruntime < sched -> min_vruntime){
+    job -> vruntime = sched -> min_vruntime;
+  }
+  job -> aged_priority = (long long)job -> priority * sched -> aging_interval + time;
+  sched -> runnable_tickets += job_weight(job -> priority);
+  sched -> class_tickets[job_class(job -> priority)] += job_weight(job -> priority);
+  if(sched -> policy -> enqueue != NULL){
+    sched -> policy -> enqueue(job, time);
+  }
+  int core = place_new_job(job, time);
+  STAT_LEAVE(ENTRY_JOB_UNBLOCKED);
+  return core;
+}
+
+
+/**
+  When the scheme is set to RR, CFS or STRIDE, called when the quantum timer has expired
+  on a core.
+ 
+  If any job should be scheduled to run on the core free'd up by
+  the quantum expiration, return the job_number of the job that should be
+  scheduled to run on core core_id.
+
+  @param core_id the zero-based index of the core where the quantum has expired.
+  @param time the current time of the simulator. 
+  @return job_number of the job that should be scheduled on core cord_id
+  @return -1 if core should remain idle
+ */
+scheduler_id_t scheduler_quantum_expired(int core_id, scheduler_time_t time)
+{
+  STAT_ENTER();
+  decrease_remaining_time(time);
+  job_t* expired_job = sched -> core_used[core_id];
+  runqueue_t* rq = local_queue(core_id);
+  if(queue_size(rq) > 0){
+    job_t* requeued_job = expired_job;
+    queue_requeue(rq, requeued_job, time);
+    expired_job = queue_poll_affine(rq, core_id, requeued_job);
+    if(expired_job != requeued_job){
+      STAT_INC(quantum_requeues);
+    }
+    else{
+      STAT_INC(quantum_continues);
+    }
+    if(expired_job -> start_time == -1){
+      expired_job -> start_time = time;
+    }
+    expired_job -> last_core = core_id;
+    note_dispatch(expired_job, time);
+    sched -> core_used[core_id] = expired_job;
+  }
+  else{
+    STAT_INC(quantum_continues);
+  }
+  STAT_LEAVE(ENTRY_QUANTUM_EXPIRED);
+  return expired_job -> job_id;
+}
+
+
+/**
+  Called when the job running on a core held it for ticks time units
+  without running, such as dispatch overhead or cache warm-up after a
+  migration. The next call does not count them toward the job's remaining
+  time or virtual runtime, only toward the time it held the core.
+
+  @param core_id the zero-based index of the core that stalled.
+  @param ticks the number of time units it stalled for.
+ */
+void scheduler_core_stalled(int core_id, scheduler_time_t ticks)
+{
+  sched -> core_stalled[core_id] += ticks;
+}
+
+
+/**
+  Returns the average waiting time of all jobs scheduled by your scheduler.
+
+  Assumptions:
+    - This function will only be called after all scheduling is complete (all jobs that have arrived will have finished and no new jobs will arrive).
+  @return the average waiting time of all jobs scheduled.
+ */
+double scheduler_average_waiting_time()
+{
+  if(sched -> num_jobs > 0){
+    return (double)sched -> wait_time / sched -> num_jobs;
+  }
+	return 0.0;
+}
+
+
+/**
+  Returns the average turnaround time of all jobs scheduled by your scheduler.
+
+  Assumptions:
+    - This function will only be called after all scheduling is complete (all jobs that have arrived will have finished and no new jobs will arrive).
+  @return the average turnaround time of all jobs scheduled.
+ */
+double scheduler_average_turnaround_time()
+{
+  if(sched -> num_jobs > 0){
+    return (double)sched -> turnaround_time / sched -> num_jobs;
+  }
+	return 0.0;
+}
+
+
+/**
+  Returns the average response time of all jobs scheduled by your scheduler.
+
+  Assumptions:
+    - This function will only be called after all scheduling is complete (all jobs that have arrived will have finished and no new jobs will arrive).
+  @return the average response time of all jobs scheduled.
+ */
+double scheduler_average_response_time()
+{
+  if(sched -> num_jobs > 0){
+    long long response_time = response_is_wait() ? sched -> wait_time : sched -> response_time;
+    return (double)response_time / sched -> num_jobs;
+  }
+	return 0.0;
+}
+
+
+/**
+  Returns the number of jobs with a deadline that has finished.
+  @return the number of finished jobs that had a deadline.
+ */
+long long scheduler_deadline_jobs()
+{
+  return sched -> deadline_jobs;
+}
+
+
+/**
+  Returns the number of jobs that finished after their deadline.
+  @return the number of deadline misses.
+ */
+long long scheduler_deadline_misses()
+{
+  return sched -> deadline_misses;
+}
+
+
+/**
+  Returns the fraction of jobs with a deadline that missed it.
+  @return the deadline miss ratio, between 0 and 1.
+ */
+double scheduler_deadline_miss_ratio()
+{
+  if(sched -> deadline_jobs > 0){
+    return (double)sched -> deadline_misses / sched -> deadline_jobs;
+  }
+  return 0.0;
+}
+
+
+/**
+  Returns a percentile of the lateness (finish time minus deadline; negative
+  when the job finished early) of the finished jobs with a deadline, using
+  the nearest-rank method. Lateness is kept in two constant-size histograms,
+  so the result is exact below 32 and within about 1/16 above.
+
+  @param percentile the percentile to return, between 0 and 100.
+  @return the lateness at the given percentile, 0 if no job had a deadline.
+ */
+scheduler_time_t scheduler_lateness_percentile(double percentile)
+{
+  if(sched -> deadline_jobs == 0){
+    return 0;
+  }
+  unsigned long long early = histogram_count(&sched -> lateness_early);
+  unsigned long long rank = (unsigned long long)(percentile / 100.0 * sched -> deadline_jobs + 0.999999);
+  if(rank < 1){
+    rank = 1;
+  }
+  if(rank <= early){
+    //the earliest finishers have the most negative lateness
+    return -(scheduler_time_t)histogram_at_rank(&sched -> lateness_early, early - rank + 1);
+  }
+  return (scheduler_time_t)histogram_at_rank(&sched -> lateness_late, rank - early);
+}
+
+
+/**
+  Returns a percentile of the waiting, turnaround or response time of the
+  finished jobs. The values come from constant-size log-linear histograms:
+  exact below 32 time units and within about 1/16 above; percentile 100 is
+  the exact maximum. Valid at any time, over the jobs finished so far.
+
+  @param metric which latency to report.
+  @param percentile the percentile to return, between 0 and 100.
+  @return the latency at the given percentile, 0 if no job has finished.
+ */
+long long scheduler_latency_percentile(metric_t metric, double percentile)
+{
+  return (long long)histogram_percentile(&sched -> latency[metric], percentile);
+}
+
+
+/**
+  Returns the mean of a latency over the finished jobs (for
+  METRIC_IO_RESPONSE, over the CPU bursts dispatched after I/O).
+
+  @param metric which latency to report.
+  @return the mean latency, 0 if there is no sample.
+ */
+double scheduler_latency_mean(metric_t metric)
+{
+  return histogram_mean(&sched -> latency[metric]);
+}
+
+
+/**
+  Same as scheduler_latency_percentile(), restricted to the jobs of one
+  priority class.
+
+  @param metric which latency to report.
+  @param priority the priority class, clamped to -20..19.
+  @param percentile the percentile to return, between 0 and 100.
+  @return the latency at the given percentile, 0 if no job of the class has finished.
+ */
+long long scheduler_class_latency_percentile(metric_t metric, int priority, double percentile)
+{
+  histogram_t* h = sched -> class_latency[job_class(priority)][metric];
+  if(h == NULL){
+    return 0;
+  }
+  return (long long)histogram_percentile(h, percentile);
+}
+
+
+/**
+  Returns how many jobs of a priority class have finished.
+
+  @param priority the priority class, clamped to -20..19.
+  @return the number of finished jobs of the class.
+ */
+long long scheduler_class_jobs(int priority)
+{
+  histogram_t* h = sched -> class_latency[job_class(priority)][METRIC_WAITING];
+  if(h == NULL){
+    return 0;
+  }
+  return (long long)histogram_count(h);
+}
+
+
+/**
+  Returns the share of the contended CPU time (time units in which at least
+  one job was waiting in the ready queue) that jobs of the given priority
+  class received.
+
+  @param priority the priority class, clamped to -20..19.
+  @return the achieved share, between 0 and 1.
+ */
+double scheduler_cpu_share(int priority)
+{
+  if(sched -> contended_cpu_time > 0){
+    return (double)sched -> class_cpu_time[job_class(priority)] / sched -> contended_cpu_time;
+  }
+  return 0.0;
+}
+
+
+/**
+  Returns the share of the contended CPU time the given priority class was
+  entitled to, from the tickets (the CFS load weight of each priority) of
+  the jobs that were runnable at the time.
+
+  @param priority the priority class, clamped to -20..19.
+  @return the entitled share, between 0 and 1.
+ */
+double scheduler_entitled_share(int priority)
+{
+  if(sched -> contended_cpu_time > 0){
+    return sched -> class_entitled_time[job_class(priority)] / sched -> contended_cpu_time;
+  }
+  return 0.0;
+}
+
+
+/**
+  Returns the average length of the run queue of a core over the run. With a
+  single global run queue every core reports the length of that queue.
+
+  @param core_id the zero-based index of the core.
+  @return the time-averaged number of jobs waiting in the core's run queue.
+ */
+double scheduler_average_queue_length(int core_id)
+{
+  if(sched -> current_time > 0){
+    return (double)local_queue(core_id) -> length_time / sched -> current_time;
+  }
+  return 0.0;
+}
+
+
+/**
+  Returns how many jobs a core took from another core's run queue because
+  its own was empty. Always 0 with a single global run queue.
+
+  @param core_id the zero-based index of the core.
+  @return the number of steals by the core.
+ */
+long long scheduler_steals(int core_id)
+{
+  return sched -> runqueues[core_id].steals;
+}
+
+
+/**
+  Returns a job that admission control dropped from the ready queue to make
+  room for an arrival, and forgets it. Call after every scheduler_new_job()
+  or scheduler_new_jobs() until it returns -1; dropped jobs are never
+  scheduled again.
+
+  @return the job_number of a dropped job, -1 if none is left to collect.
+ */
+scheduler_id_t scheduler_shed_job()
+{
+  if(sched -> shed_pending == 0){
+    return -1;
+  }
+  return sched -> shed_ids[--sched -> shed_pending];
+}
+
+
+/**
+  Returns how many arrivals admission control turned away.
+  @return the number of arrivals given SCHEDULER_SHED.
+ */
+long long scheduler_rejected_jobs()
+{
+  return sched -> rejected_jobs;
+}
 
-priqueue_t queue;
-int preemptive;
-int num_cores;
-int num_jobs;
-int current_time;
-float wait_time;
-float turnaround_time;
-float response_time;
-int (*comp)(const void *, const void *);
 
-typedef struct _job_t{
-  int job_id;
-  int priority;
-  int arrival_time;
-  int running_time;
-  int remaining_time;
-  int start_time;
-} job_t;
+/**
+  Returns how many queued jobs admission control dropped.
+  @return the number of jobs returned by scheduler_shed_job().
+ */
+long long scheduler_dropped_jobs()
+{
+  return sched -> dropped_jobs;
+}
 
-job_t** core_used;
 
+/**
+  Fills in a live view of the scheduler. Unlike the scheduler_average_*
+  functions this may be called at any time, between any two scheduler
+  calls; latencies cover the jobs that have finished so far. It does not
+  change any scheduler state.
 
-int comapreFCFS(const void *a, const void *b)
+  @param time the current time of the simulator, used for the throughput.
+  @param snapshot where to store the snapshot.
+ */
+void scheduler_snapshot(scheduler_time_t time, scheduler_snapshot_t *snapshot)
 {
-  job_t* job_a = (job_t*)a;
-  job_t* job_b = (job_t*)b;
-  if(job_a -> job_id == job_b -> job_id){
-    return 0;
+  int i;
+  snapshot -> time = time;
+  snapshot -> arrived_jobs = sched -> arrived_jobs;
+  snapshot -> finished_jobs = sched -> num_jobs;
+  snapshot -> shed_jobs = sched -> rejected_jobs + sched -> dropped_jobs;
+  snapshot -> in_flight_jobs = sched -> arrived_jobs - sched -> num_jobs - snapshot -> shed_jobs;
+  snapshot -> queue_depth = sched -> queued_jobs;
+  snapshot -> busy_cores = 0;
+  for(i = 0; i < sched -> num_cores; i++){
+    if(sched -> core_used[i] != 0){
+      snapshot -> busy_cores++;
+    }
   }
-  return job_a -> arrival_time - job_b -> arrival_time;
+  snapshot -> throughput = (time > 0) ? (double)sched -> num_jobs / time : 0.0;
+  snapshot -> mean_waiting_time = histogram_mean(&sched -> latency[METRIC_WAITING]);
+  snapshot -> mean_turnaround_time = histogram_mean(&sched -> latency[METRIC_TURNAROUND]);
+  snapshot -> mean_response_time = histogram_mean(&sched -> latency[METRIC_RESPONSE]);
+  snapshot -> p50_waiting_time = (long long)histogram_percentile(&sched -> latency[METRIC_WAITING], 50);
+  snapshot -> p99_waiting_time = (long long)histogram_percentile(&sched -> latency[METRIC_WAITING], 99);
 }
 
-int compareSJF(const void *a, const void *b)
+
+/**
+  Tells whether the library was built with the statistics counters.
+  @return 1 if SCHEDULER_STATS was defined, 0 if the counters read 0.
+ */
+int scheduler_stats_enabled()
 {
-  job_t* job_a = (job_t*)a;
-  job_t* job_b = (job_t*)b;
-  if(job_a -> job_id == job_b -> job_id){
-    return 0;
-  }
-  int diff = job_a -> remaining_time - job_b -> remaining_time;
-  if(diff == 0){
-    return job_a -> arrival_time - job_b -> arrival_time;
-  }
-  else{
-    return diff;
-  }
+#ifdef SCHEDULER_STATS
+  return 1;
+#else
+  return 0;
+#endif
 }
 
-int comparePRI(const void *a, const void *b)
+
+/**
+  Copies the internal counters of the scheduler into stats_out.
+
+  @param stats_out where to store the counters; all 0 unless the library was
+  built with SCHEDULER_STATS.
+ */
+void scheduler_get_stats(scheduler_stats_t *stats_out)
 {
-  job_t* job_a = (job_t*)a;
-  job_t* job_b = (job_t*)b;
-  if(job_a -> job_id == job_b -> job_id){
-    return 0;
-  }
-  int diff = job_a -> priority - job_b -> priority;
-  if(diff == 0){
-    return job_a -> arrival_time - job_b -> arrival_time;
-  }
-  else{
-    return diff;
-  }
+#ifdef SCHEDULER_STATS
+  *stats_out = sched -> stats;
+  stats_out -> mean_queue_depth = sched -> depth_samples > 0 ? (double)sched -> depth_sum / sched -> depth_samples : 0.0;
+#else
+  memset(stats_out, 0, sizeof(scheduler_stats_t));
+#endif
 }
 
-int compareRR(const void *a, const void *b)
+
+/**
+  Prints the statistics the policy keeps itself, if it has a stats hook.
+  Unlike scheduler_get_stats() this does not depend on SCHEDULER_STATS.
+
+  @param out where to print.
+ */
+void scheduler_policy_stats(FILE *out)
 {
-  job_t* job_a = (job_t*)a;
-  job_t* job_b = (job_t*)b;
-  if(job_a -> job_id == job_b -> job_id){
-    return 0;
+  if(sched -> policy -> stats != NULL){
+    sched -> policy -> stats(out);
   }
-  return -1;
 }
 
-/**
-  Initalizes the scheduler.
- 
-  Assumptions:
-    - You may assume this will be the first scheduler function called.
-    - You may assume this function will be called once once.
-    - You may assume that cores is a positive, non-zero number.
-    - You may assume that scheme is a valid scheduling scheme.
 
-  @param cores the number of cores that is available by the scheduler. These cores will be known as core(id=0), core(id=1), ..., core(id=cores-1).
-  @param scheme  the scheduling scheme that should be used. This value will be one of the six enum values of scheme_t
+/**
+  Checkpoints are a raw dump of the scheduler's state in the byte order and
+  struct layout of the machine that wrote them, so they are only read back
+  by the same build.
 */
-void scheduler_start_up(int cores, scheme_t scheme)
+#define CHECKPOINT_MAGIC 0x33504b43 //"CKP3"
+
+static int save_bytes(FILE* file, const void* data, size_t size)
 {
-  wait_time = 0.0;
-  turnaround_time = 0.0;
-  response_time = 0.0;
-  num_jobs = 0;
-  current_time = 0;
-  num_cores = cores;
-  core_used = malloc(sizeof(job_t) * cores);
-  int i = 0;
+  return size == 0 || fwrite(data, size, 1, file) == 1;
+}
 
-  while(i < cores){
-    core_used[i] = 0;
-    i++;
+static int load_bytes(FILE* file, void* data, size_t size)
+{
+  return size == 0 || fread(data, size, 1, file) == 1;
+}
+
+/**
+  A histogram is mostly empty buckets, so only the used ones are written,
+  as index and count pairs.
+*/
+static int save_histogram(FILE* file, const histogram_t* h)
+{
+  int used = 0;
+  int i;
+  for(i = 0; i < HISTOGRAM_BUCKETS; i++){
+    if(h -> counts[i] != 0){
+      used++;
+    }
   }
-  switch(scheme){
-      case FCFS: 
-        comp = comapreFCFS; 
-        preemptive = 0; 
-        break;
-    case SJF:  
-        comp = compareSJF;  
-        preemptive = 0; 
-        break;
-        case PSJF: 
-        comp = compareSJF;  
-        preemptive = 1; 
-        break;
-        case PRI:  
-        comp = comparePRI;  
-        preemptive = 0; 
-        break;
-        case PPRI: 
-        comp = comparePRI;  
-        preemptive = 1; 
-        break;
-        case RR:   
-        comp = compareRR;   
-        preemptive = 0; 
-        break;
+  int ok = save_bytes(file, &h -> total, sizeof(h -> total)) && save_bytes(file, &h -> sum, sizeof(h -> sum)) &&
+           save_bytes(file, &h -> min, sizeof(h -> min)) && save_bytes(file, &h -> max, sizeof(h -> max)) &&
+           save_bytes(file, &used, sizeof(used));
+  for(i = 0; ok && i < HISTOGRAM_BUCKETS; i++){
+    if(h -> counts[i] != 0){
+      ok = save_bytes(file, &i, sizeof(i)) && save_bytes(file, &h -> counts[i], sizeof(h -> counts[i]));
+    }
   }
-  priqueue_init(&queue, comp);
+  return ok;
 }
 
+static int load_histogram(FILE* file, histogram_t* h)
+{
+  int used, index;
+  histogram_init(h);
+  int ok = load_bytes(file, &h -> total, sizeof(h -> total)) && load_bytes(file, &h -> sum, sizeof(h -> sum)) &&
+           load_bytes(file, &h -> min, sizeof(h -> min)) && load_bytes(file, &h -> max, sizeof(h -> max)) &&
+           load_bytes(file, &used, sizeof(used));
+  while(ok && used-- > 0){
+    ok = load_bytes(file, &index, sizeof(index)) && index >= 0 && index < HISTOGRAM_BUCKETS &&
+         load_bytes(file, &h -> counts[index], sizeof(h -> counts[index]));
+  }
+  return ok;
+}
 
 /**
-  Called when a new job arrives.
-  If multiple cores are idle, the job should be assigned to the core with the
-  lowest id.
-  If the job arriving should be scheduled to run during the next
-  time cycle, return the zero-based index of the core the job should be
-  scheduled on. If another job is already running on the core specified,
-  this will preempt the currently running job.
-  Assumption:
-    - You may assume that every job wil have a unique arrival time.
+  Writes a job, followed by its I/O bookkeeping if it has any.
+*/
+static int save_job(FILE* file, job_t* job)
+{
+  return save_bytes(file, job, sizeof(job_t)) && (job -> io == NULL || save_bytes(file, job -> io, sizeof(job_io_t)));
+}
 
-  @param job_number a globally unique identification number of the job arriving.
-  @param time the current time of the simulator.
-  @param running_time the total number of time units this job will run before it will be finished.
-  @param priority the priority of the job. (The lower the value, the higher the priority.)
-  @return index of core job should be scheduled on
-  @return -1 if no scheduling changes should be made. 
- 
- */
-int scheduler_new_job(int job_number, int time, int running_time, int priority)
+/**
+  Reads what save_job() wrote into a newly allocated job.
+  @return the job, or NULL on a short read.
+*/
+static job_t* load_job(FILE* file)
 {
-  decrease_remaining_time(time);
   job_t* job = malloc(sizeof(job_t));
-  job -> job_id = job_number;
-  job -> arrival_time = time;
-  job -> running_time = running_time;
-  job -> priority = priority;
-  job -> remaining_time = running_time;
-  job -> start_time = -1;
+  if(!load_bytes(file, job, sizeof(job_t))){
+    free(job);
+    return NULL;
+  }
+  if(job -> io != NULL){
+    job -> io = malloc(sizeof(job_io_t));
+    if(!load_bytes(file, job -> io, sizeof(job_io_t))){
+      free_job(job);
+      return NULL;
+    }
+  }
+  return job;
+}
 
-  int core = check_idle_core();
-  if(core != -1){
-    core_used[core] = job;
-    job -> start_time = time;
-    return core;
+/**
+  Writes count jobs, preceded by count.
+*/
+static int save_jobs(FILE* file, job_t** jobs, int count)
+{
+  int ok = save_bytes(file, &count, sizeof(count));
+  int i;
+  for(i = 0; ok && i < count; i++){
+    ok = save_job(file, jobs[i]);
   }
+  return ok;
+}
 
-  if(preemptive){
-    core = lowest_priority_job(job);
-    if(core > -1){
-      job_t* temp = core_used[core];
-      if(time == temp -> start_time){
-        temp -> start_time = -1;
+/**
+  Reads what save_jobs() wrote into newly allocated jobs.
+  @return the jobs, with their number in count_out, or NULL on a short read.
+*/
+static job_t** load_jobs(FILE* file, int* count_out)
+{
+  int count;
+  if(!load_bytes(file, &count, sizeof(count)) || count < 0){
+    return NULL;
+  }
+  job_t** jobs = malloc(sizeof(job_t*) * (count + 1));
+  int i;
+  for(i = 0; i < count; i++){
+    jobs[i] = load_job(file);
+    if(jobs[i] == NULL){
+      for(i--; i >= 0; i--){
+        free_job(jobs[i]);
       }
-      job -> start_time = time;
-      core_used[core] = job;
-      priqueue_offer(&queue, temp);
-      return core;
+      free(jobs);
+      return NULL;
     }
   }
-  priqueue_offer(&queue,(void*)job);
-	return -1;
+  *count_out = count;
+  return jobs;
 }
 
-
 /**
-  Called when a job has completed execution.
- 
-  The core_id, job_number and time parameters are provided for convenience. You may be able to calculate the values with your own data structure.
-  If any job should be scheduled to run on the core free'd up by the
-  finished job, return the job_number of the job that should be scheduled to
-  run on core core_id.
- 
-  @param core_id the zero-based index of the core where the job was located.
-  @param job_number a globally unique identification number of the job.
-  @param time the current time of the simulator.
-  @return job_number of the job that should be scheduled to run on core core_id
-  @return -1 if core should remain idle.
- */
-int scheduler_job_finished(int core_id, int job_number, int time)
+  Writes the jobs of a ready queue in queue order. The heap is written in
+  array order, which pushing the jobs back in the same order reproduces.
+*/
+static int save_queue(FILE* file, runqueue_t* rq)
 {
-  decrease_remaining_time(time);
-  job_t* finished_job = core_used[core_id];
-  num_jobs++;
-  wait_time += (time - finished_job -> arrival_time - finished_job -> running_time);
-  turnaround_time += (time - finished_job -> arrival_time);
-  response_time += (finished_job -> start_time - finished_job -> arrival_time);
-  free(core_used[core_id]);
-  core_used[core_id] = 0;
-  if(priqueue_size(&queue) > 0){
-    job_t* next_job = (job_t*)priqueue_poll(&queue);
-    if(next_job -> start_time == -1){
-      next_job -> start_time = time;
-    }
-    core_used[core_id] = next_job;
-    return next_job -> job_id;
+  int count = queue_size(rq);
+  job_t** jobs = malloc(sizeof(job_t*) * (count + 1));
+  int i = 0;
+  if(sched -> queue_kind == QUEUE_TREE){
+    rbtree_to_array(&rq -> tree, (void**)jobs);
   }
-	return -1;
+  else if(sched -> queue_kind == QUEUE_HEAP){
+    for(i = 0; i < count; i++){
+      jobs[i] = (job_t*)heap_at(&rq -> heap, i);
+    }
+  }
+  else{
+    Node* node;
+    for(node = rq -> list.top; node != NULL; node = node -> next){
+      jobs[i++] = (job_t*)node -> data;
+    }
+  }
+  int ok = save_jobs(file, jobs, count);
+  free(jobs);
+  return ok;
 }
 
-
 /**
-  When the scheme is set to RR, called when the quantum timer has expired
-  on a core.
- 
-  If any job should be scheduled to run on the core free'd up by
-  the quantum expiration, return the job_number of the job that should be
-  scheduled to run on core core_id.
-
-  @param core_id the zero-based index of the core where the quantum has expired.
-  @param time the current time of the simulator. 
-  @return job_number of the job that should be scheduled on core cord_id
-  @return -1 if core should remain idle
- */
-int scheduler_quantum_expired(int core_id, int time)
+  Puts the jobs a checkpoint had in a ready queue back into rq. Under the
+  policy that wrote them they go back in the same order (equal elements
+  keep their insertion order in all three structures, and an empty list
+  appends what priqueue_offer_sorted() is given); under another policy
+  they are offered one by one, so its comparator orders them.
+*/
+static void restore_queue(runqueue_t* rq, job_t** jobs, int count, int same_policy)
 {
-  decrease_remaining_time(time);
-  job_t* expired_job = core_used[core_id];
-  if(priqueue_size(&queue) > 0){
-    priqueue_offer(&queue, expired_job);
-    expired_job = priqueue_poll(&queue);
-    if(expired_job -> start_time == -1){
-      expired_job -> start_time = time;
+  int i;
+  if(!same_policy){
+    for(i = 0; i < count; i++){
+      queue_offer(rq, jobs[i]);
     }
-    core_used[core_id] = expired_job;
+    return;
   }
-  return expired_job -> job_id;
-	return -1;
+  switch(sched -> queue_kind){
+    case QUEUE_TREE:
+      for(i = 0; i < count; i++){
+        rbtree_insert(&rq -> tree, jobs[i]);
+      }
+      break;
+    case QUEUE_HEAP:
+      for(i = 0; i < count; i++){
+        heap_push(&rq -> heap, jobs[i]);
+      }
+      break;
+    default:
+      priqueue_offer_sorted(&rq -> list, (void**)jobs, count);
+      break;
+  }
+  if(tracks_shed_order()){
+    for(i = 0; i < count; i++){
+      rbtree_insert(&sched -> shed_order, jobs[i]);
+    }
+  }
+  sched -> queued_jobs += count;
 }
 
 
 /**
-  Returns the average waiting time of all jobs scheduled by your scheduler.
+  Writes the state of the scheduler to file, so that scheduler_restore()
+  can continue from this point: every job with the order of the ready
+  queues, the running and blocked jobs, and the accumulators behind the
+  averages, distributions and counters. Call between scheduler calls.
+  State a loaded policy keeps itself and arrivals still in the submission
+  ring are not included.
 
-  Assumptions:
-    - This function will only be called after all scheduling is complete (all jobs that have arrived will have finished and no new jobs will arrive).
-  @return the average waiting time of all jobs scheduled.
+  @param file where to write, opened for writing in binary mode.
+  @return 0 on success, -1 if writing failed.
  */
-float scheduler_average_waiting_time()
+int scheduler_checkpoint(FILE *file)
 {
-  if(num_jobs > 0){
-    return wait_time / num_jobs;
+  int magic = CHECKPOINT_MAGIC;
+  int name_length = strlen(sched -> policy -> name);
+  int speeds = (sched -> core_speed != NULL);
+  int stats = scheduler_stats_enabled();
+  int ok = save_bytes(file, &magic, sizeof(magic)) &&
+           save_bytes(file, &sched -> num_cores, sizeof(int)) && save_bytes(file, &sched -> num_queues, sizeof(int)) &&
+           save_bytes(file, &speeds, sizeof(speeds)) && save_bytes(file, &stats, sizeof(stats)) &&
+           save_bytes(file, &name_length, sizeof(name_length)) && save_bytes(file, sched -> policy -> name, name_length) &&
+           save_bytes(file, &sched -> queue_kind, sizeof(sched -> queue_kind));
+
+  /* accumulators */
+  ok = ok && save_bytes(file, &sched -> num_jobs, sizeof(sched -> num_jobs)) &&
+       save_bytes(file, &sched -> arrived_jobs, sizeof(sched -> arrived_jobs)) &&
+       save_bytes(file, &sched -> current_time, sizeof(sched -> current_time)) &&
+       save_bytes(file, &sched -> wait_time, sizeof(sched -> wait_time)) &&
+       save_bytes(file, &sched -> turnaround_time, sizeof(sched -> turnaround_time)) &&
+       save_bytes(file, &sched -> response_time, sizeof(sched -> response_time)) &&
+       save_bytes(file, &sched -> burst_ewma, sizeof(sched -> burst_ewma)) &&
+       save_bytes(file, &sched -> min_vruntime, sizeof(sched -> min_vruntime)) &&
+       save_bytes(file, &sched -> deadline_jobs, sizeof(sched -> deadline_jobs)) &&
+       save_bytes(file, &sched -> deadline_misses, sizeof(sched -> deadline_misses)) &&
+       save_bytes(file, &sched -> runnable_tickets, sizeof(sched -> runnable_tickets)) &&
+       save_bytes(file, sched -> class_tickets, sizeof(sched -> class_tickets)) &&
+       save_bytes(file, sched -> class_cpu_time, sizeof(sched -> class_cpu_time)) &&
+       save_bytes(file, sched -> class_entitled_time, sizeof(sched -> class_entitled_time)) &&
+       save_bytes(file, &sched -> contended_cpu_time, sizeof(sched -> contended_cpu_time)) &&
+       save_bytes(file, &sched -> rejected_jobs, sizeof(sched -> rejected_jobs)) &&
+       save_bytes(file, &sched -> dropped_jobs, sizeof(sched -> dropped_jobs)) &&
+       save_bytes(file, &sched -> shed_pending, sizeof(sched -> shed_pending)) &&
+       save_bytes(file, sched -> shed_ids, sizeof(scheduler_id_t) * sched -> shed_pending) &&
+       save_bytes(file, sched -> core_stalled, sizeof(scheduler_time_t) * sched -> num_cores);
+  if(speeds){
+    ok = ok && save_bytes(file, sched -> core_credit, sizeof(int) * sched -> num_cores);
   }
-	return 0.0;
+#ifdef SCHEDULER_STATS
+  ok = ok && save_bytes(file, &sched -> stats, sizeof(sched -> stats)) &&
+       save_bytes(file, &sched -> depth_samples, sizeof(sched -> depth_samples)) &&
+       save_bytes(file, &sched -> depth_sum, sizeof(sched -> depth_sum));
+#endif
+
+  /* distributions */
+  int i, m;
+  ok = ok && save_histogram(file, &sched -> lateness_early) && save_histogram(file, &sched -> lateness_late);
+  for(m = 0; ok && m < NUM_METRICS; m++){
+    ok = save_histogram(file, &sched -> latency[m]);
+  }
+  for(i = 0; ok && i < NUM_CLASSES; i++){
+    for(m = 0; ok && m < NUM_METRICS; m++){
+      int present = (sched -> class_latency[i][m] != NULL);
+      ok = save_bytes(file, &present, sizeof(present)) && (!present || save_histogram(file, sched -> class_latency[i][m]));
+    }
+  }
+
+  /* jobs */
+  for(i = 0; ok && i < sched -> num_cores; i++){
+    int running = (sched -> core_used[i] != NULL);
+    ok = save_bytes(file, &running, sizeof(running)) && (!running || save_job(file, sched -> core_used[i]));
+  }
+  for(i = 0; ok && i < sched -> num_cores; i++){
+    runqueue_t* rq = &sched -> runqueues[i];
+    ok = save_bytes(file, &rq -> length_time, sizeof(rq -> length_time)) && save_bytes(file, &rq -> steals, sizeof(rq -> steals)) &&
+         save_queue(file, rq);
+  }
+  if(ok){
+    job_t** blocked = malloc(sizeof(job_t*) * (rbtree_size(&sched -> blocked) + 1));
+    rbtree_to_array(&sched -> blocked, (void**)blocked);
+    ok = save_jobs(file, blocked, rbtree_size(&sched -> blocked));
+    free(blocked);
+  }
+  return ok ? 0 : -1;
 }
 
 
 /**
-  Returns the average turnaround time of all jobs scheduled by your scheduler.
+  Continues from a checkpoint written by scheduler_checkpoint(). Call right
+  after scheduler_start_up*() and the scheduler_set_*() calls, before any
+  job arrives. The number of cores, per-core queues and whether core speeds
+  are set must be as when the checkpoint was written; the policy and the
+  other settings may differ, for what-if runs from a common starting point.
+  Under another policy the queued jobs are ordered by its comparator, and
+  the running jobs keep their cores until its next decision.
 
-  Assumptions:
-    - This function will only be called after all scheduling is complete (all jobs that have arrived will have finished and no new jobs will arrive).
-  @return the average turnaround time of all jobs scheduled.
+  @param file a checkpoint, opened for reading in binary mode.
+  @return 0 on success, -1 if the file is not a checkpoint of a compatible
+  scheduler or is truncated, in which case the scheduler should only be
+  cleaned up.
  */
-float scheduler_average_turnaround_time()
+int scheduler_restore(FILE *file)
 {
-  if(num_jobs > 0){
-    return turnaround_time / num_jobs;
+  int magic, cores, queues, speeds, stats, name_length;
+  queue_kind_t queue_kind;
+  char name[256];
+  if(!load_bytes(file, &magic, sizeof(magic)) || magic != CHECKPOINT_MAGIC ||
+     !load_bytes(file, &cores, sizeof(cores)) || !load_bytes(file, &queues, sizeof(queues)) ||
+     !load_bytes(file, &speeds, sizeof(speeds)) || !load_bytes(file, &stats, sizeof(stats)) ||
+     !load_bytes(file, &name_length, sizeof(name_length)) || name_length < 0 || name_length >= (int)sizeof(name) ||
+     !load_bytes(file, name, name_length) || !load_bytes(file, &queue_kind, sizeof(queue_kind))){
+    return -1;
   }
-	return 0.0;
-}
+  name[name_length] = '\0';
+  if(cores != sched -> num_cores || queues != sched -> num_queues || speeds != (sched -> core_speed != NULL) ||
+     stats != scheduler_stats_enabled()){
+    return -1;
+  }
+  int same_policy = (queue_kind == sched -> queue_kind && strcmp(name, sched -> policy -> name) == 0);
 
+  /* accumulators */
+  int ok = load_bytes(file, &sched -> num_jobs, sizeof(sched -> num_jobs)) &&
+           load_bytes(file, &sched -> arrived_jobs, sizeof(sched -> arrived_jobs)) &&
+           load_bytes(file, &sched -> current_time, sizeof(sched -> current_time)) &&
+           load_bytes(file, &sched -> wait_time, sizeof(sched -> wait_time)) &&
+           load_bytes(file, &sched -> turnaround_time, sizeof(sched -> turnaround_time)) &&
+           load_bytes(file, &sched -> response_time, sizeof(sched -> response_time)) &&
+           load_bytes(file, &sched -> burst_ewma, sizeof(sched -> burst_ewma)) &&
+           load_bytes(file, &sched -> min_vruntime, sizeof(sched -> min_vruntime)) &&
+           load_bytes(file, &sched -> deadline_jobs, sizeof(sched -> deadline_jobs)) &&
+           load_bytes(file, &sched -> deadline_misses, sizeof(sched -> deadline_misses)) &&
+           load_bytes(file, &sched -> runnable_tickets, sizeof(sched -> runnable_tickets)) &&
+           load_bytes(file, sched -> class_tickets, sizeof(sched -> class_tickets)) &&
+           load_bytes(file, sched -> class_cpu_time, sizeof(sched -> class_cpu_time)) &&
+           load_bytes(file, sched -> class_entitled_time, sizeof(sched -> class_entitled_time)) &&
+           load_bytes(file, &sched -> contended_cpu_time, sizeof(sched -> contended_cpu_time)) &&
+           load_bytes(file, &sched -> rejected_jobs, sizeof(sched -> rejected_jobs)) &&
+           load_bytes(file, &sched -> dropped_jobs, sizeof(sched -> dropped_jobs)) &&
+           load_bytes(file, &sched -> shed_pending, sizeof(sched -> shed_pending)) &&
+           sched -> shed_pending >= 0;
+  if(ok && sched -> shed_pending > 0){
+    sched -> shed_capacity = sched -> shed_pending;
+    sched -> shed_ids = realloc(sched -> shed_ids, sizeof(scheduler_id_t) * sched -> shed_capacity);
+    ok = load_bytes(file, sched -> shed_ids, sizeof(scheduler_id_t) * sched -> shed_pending);
+  }
+  ok = ok && load_bytes(file, sched -> core_stalled, sizeof(scheduler_time_t) * sched -> num_cores);
+  if(speeds){
+    ok = ok && load_bytes(file, sched -> core_credit, sizeof(int) * sched -> num_cores);
+  }
+#ifdef SCHEDULER_STATS
+  ok = ok && load_bytes(file, &sched -> stats, sizeof(sched -> stats)) &&
+       load_bytes(file, &sched -> depth_samples, sizeof(sched -> depth_samples)) &&
+       load_bytes(file, &sched -> depth_sum, sizeof(sched -> depth_sum));
+#endif
 
-/**
-  Returns the average response time of all jobs scheduled by your scheduler.
+  /* distributions */
+  int i, m;
+  ok = ok && load_histogram(file, &sched -> lateness_early) && load_histogram(file, &sched -> lateness_late);
+  for(m = 0; ok && m < NUM_METRICS; m++){
+    ok = load_histogram(file, &sched -> latency[m]);
+  }
+  for(i = 0; ok && i < NUM_CLASSES; i++){
+    for(m = 0; ok && m < NUM_METRICS; m++){
+      int present;
+      ok = load_bytes(file, &present, sizeof(present));
+      if(ok && present){
+        if(sched -> class_latency[i][m] == NULL){
+          sched -> class_latency[i][m] = malloc(sizeof(histogram_t));
+        }
+        ok = load_histogram(file, sched -> class_latency[i][m]);
+      }
+    }
+  }
 
-  Assumptions:
-    - This function will only be called after all scheduling is complete (all jobs that have arrived will have finished and no new jobs will arrive).
-  @return the average response time of all jobs scheduled.
- */
-float scheduler_average_response_time()
-{
-  if(!preemptive && comp != compareRR){
-    return wait_time / num_jobs;
+  /* jobs */
+  for(i = 0; ok && i < sched -> num_cores; i++){
+    int running;
+    ok = load_bytes(file, &running, sizeof(running));
+    if(ok && running){
+      sched -> core_used[i] = load_job(file);
+      ok = (sched -> core_used[i] != NULL);
+    }
   }
-  else{
-    return response_time / num_jobs;
+  for(i = 0; ok && i < sched -> num_cores; i++){
+    runqueue_t* rq = &sched -> runqueues[i];
+    job_t** jobs;
+    int count;
+    ok = load_bytes(file, &rq -> length_time, sizeof(rq -> length_time)) && load_bytes(file, &rq -> steals, sizeof(rq -> steals)) &&
+         (jobs = load_jobs(file, &count)) != NULL;
+    if(ok){
+      restore_queue(rq, jobs, count, same_policy);
+      free(jobs);
+    }
   }
-	return 0.0;
+  if(ok){
+    job_t** blocked;
+    int count;
+    ok = (blocked = load_jobs(file, &count)) != NULL;
+    for(i = 0; ok && i < count; i++){
+      rbtree_insert(&sched -> blocked, blocked[i]);
+    }
+    free(blocked);
+  }
+  return ok ? 0 : -1;
 }
 
 
@@ -327,7 +2480,36 @@ float scheduler_average_response_time()
 */
 void scheduler_clean_up()
 {
-  priqueue_destroy(&queue);
+  int i;
+  for(i = 0; i < sched -> num_cores; i++){
+    priqueue_destroy(&sched -> runqueues[i].list);
+    rbtree_destroy(&sched -> runqueues[i].tree);
+    heap_destroy(&sched -> runqueues[i].heap);
+  }
+  free(sched -> runqueues);
+  free(sched -> core_used);
+  free(sched -> core_stalled);
+  free(sched -> core_speed);
+  free(sched -> core_credit);
+  rbtree_destroy(&sched -> shed_order);
+  rbtree_destroy(&sched -> blocked);
+  free(sched -> shed_ids);
+  sched -> shed_ids = NULL;
+  if(sched -> submission_batch != NULL){
+    mpsc_destroy(&sched -> submissions);
+    free(sched -> submission_batch);
+    sched -> submission_batch = NULL;
+  }
+  if(sched -> policy_handle != NULL){
+    dlclose(sched -> policy_handle);
+    sched -> policy_handle = NULL;
+  }
+  int m;
+  for(i = 0; i < NUM_CLASSES; i++){
+    for(m = 0; m < NUM_METRICS; m++){
+      free(sched -> class_latency[i][m]);
+    }
+  }
 }
 
 
@@ -344,23 +2526,38 @@ void scheduler_clean_up()
  */
 void scheduler_show_queue()
 {
-  int x = 0;
-  int size = priqueue_size(&queue);
-  if(size ==0){
+  if(sched -> queued_jobs == 0){
     printf("Queue is empty.");
     return;
   }
-  while(x < size){
-    job_t* temp = (job_t*)priqueue_at(&queue, x);
-    printf("Index: %d Job Number:%d Arrival Time: %d Remaining Time: %d Priority: %d\n", x, temp -> job_id, temp -> arrival_time, temp -> remaining_time, temp -> priority);
-    x++;
+  int q;
+  for(q = 0; q < sched -> num_queues; q++){
+    int x = 0;
+    int size = queue_size(&sched -> runqueues[q]);
+    if(sched -> num_queues > 1 && size > 0){
+      printf("Core %d run queue:\n", q);
+    }
+    while(x < size){
+      job_t* temp = queue_at(&sched -> runqueues[q], x);
+      printf("Index: %d Job Number:%lld Arrival Time: %lld Remaining Time: %lld Priority: %d\n", x, temp -> job_id, temp -> arrival_time, temp -> remaining_time, temp -> priority);
+      x++;
+    }
   }
 }
 
 int check_idle_core(){
   int i = 0;
-  while(i < num_cores){
-    if(core_used[i] == 0){
+  if(sched -> core_speed != NULL){
+    int fastest = -1;
+    for(i = 0; i < sched -> num_cores; i++){
+      if(sched -> core_used[i] == 0 && (fastest == -1 || sched -> core_speed[i] > sched -> core_speed[fastest])){
+        fastest = i;
+      }
+    }
+    return fastest;
+  }
+  while(i < sched -> num_cores){
+    if(sched -> core_used[i] == 0){
       return i;
     }
     i++;
@@ -368,28 +2565,98 @@ int check_idle_core(){
   return -1;
 }
 
-void decrease_remaining_time(int time){
-  int diff_time = (time - current_time);
+void decrease_remaining_time(scheduler_time_t time){
+  scheduler_time_t diff_time = (time - sched -> current_time);
+  int contended = (diff_time > 0 && sched -> queued_jobs > 0);
+  int busy_cores = 0;
   int i = 0;
-  while(i < num_cores){
-    if(core_used[i] != 0){
-      core_used[i] -> remaining_time -= diff_time;
+  while(i < sched -> num_cores){
+    if(sched -> core_used[i] != 0){
+      //time units the core stalled were held but not run
+      scheduler_time_t ran_time = diff_time - sched -> core_stalled[i];
+      if(ran_time < 0){
+        ran_time = 0;
+      }
+      sched -> core_used[i] -> run_ticks += diff_time;
+      if(sched -> core_speed != NULL){
+        long long credit = sched -> core_credit[i] + (long long)sched -> core_speed[i] * ran_time;
+        sched -> core_used[i] -> remaining_time -= credit / SCHEDULER_SPEED_UNIT;
+        sched -> core_credit[i] = credit % SCHEDULER_SPEED_UNIT;
+      }
+      else{
+        sched -> core_used[i] -> remaining_time -= ran_time;
+      }
+      sched -> core_used[i] -> vruntime += ((unsigned long long)ran_time << VRUNTIME_SHIFT) * NICE_0_WEIGHT / job_weight(sched -> core_used[i] -> priority);
+      sched -> core_used[i] -> aged_priority = (long long)sched -> core_used[i] -> priority * sched -> aging_interval + time;
+      if(sched -> policy -> on_tick != NULL && ran_time > 0){
+        sched -> policy -> on_tick(sched -> core_used[i], i, ran_time);
+      }
+      if(contended){
+        sched -> class_cpu_time[job_class(sched -> core_used[i] -> priority)] += diff_time;
+        busy_cores++;
+      }
     }
     i++;
   }
-  current_time = time;
+  for(i = 0; i < sched -> num_cores; i++){
+    sched -> core_stalled[i] = 0;
+  }
+  for(i = 0; i < sched -> num_queues; i++){
+    sched -> runqueues[i].length_time += (long long)queue_size(&sched -> runqueues[i]) * diff_time;
+  }
+  if(contended){
+    sched -> contended_cpu_time += (long long)busy_cores * diff_time;
+    for(i = 0; i < NUM_CLASSES; i++){
+      if(sched -> class_tickets[i] > 0){
+        sched -> class_entitled_time[i] += (double)busy_cores * diff_time * sched -> class_tickets[i] / sched -> runnable_tickets;
+      }
+    }
+  }
+  sched -> current_time = time;
 }
 
 int lowest_priority_job(void* job){
   job_t* current_job = (job_t*)job;
   int core = -1;
   int i = 0;
-  while(i < num_cores){
-    if(comp(current_job, core_used[i]) < 0){
-      core = i;
-      current_job = core_used[i];
+  if(sched -> policy -> should_preempt != NULL){
+    //the worst running job among those the policy lets job preempt
+    while(i < sched -> num_cores){
+      if(sched -> policy -> should_preempt(job, sched -> core_used[i]) && (core == -1 || COMPARE(current_job, sched -> core_used[i]) < 0)){
+        core = i;
+        current_job = sched -> core_used[i];
+      }
+      i++;
+    }
+  }
+  else if(sched -> core_speed != NULL && sched -> comp == compareSJF){
+    //compareSJF orders by remaining time; weigh it by the speed of the core
+    long long longest = -1;
+    while(i < sched -> num_cores){
+      long long left = sched -> core_used[i] -> remaining_time * SCHEDULER_SPEED_UNIT / sched -> core_speed[i];
+      if(COMPARE(job, sched -> core_used[i]) < 0 && left > longest){
+        core = i;
+        longest = left;
+      }
+      i++;
+    }
+  }
+  else{
+    while(i < sched -> num_cores){
+      if(COMPARE(current_job, sched -> core_used[i]) < 0){
+        core = i;
+        current_job = sched -> core_used[i];
+      }
+      i++;
+    }
+  }
+  //with aging a queued job can outrank the arriving one, and it should get
+  //the core first
+  if(core != -1 && sched -> aging_interval > 0){
+    job_t* head = queue_at(local_queue(core), 0);
+    if(head != NULL && COMPARE(head, job) < 0){
+      return -1;
     }
-    i++;
   }
   return core;
 }
\ No newline at end of file
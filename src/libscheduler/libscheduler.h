@@ -4,20 +4,152 @@
 #ifndef LIBSCHEDULER_H_
 #define LIBSCHEDULER_H_
 
+#include "policy.h"
+
 /**
   Constants which represent the different scheduling algorithms
 */
-typedef enum {FCFS = 0, SJF, PSJF, PRI, PPRI, RR} scheme_t;
+typedef enum {FCFS = 0, SJF, PSJF, PRI, PPRI, RR, CFS, EDF, PEDF, STRIDE} scheme_t;
+
+/**
+  One scheduler instance. Programs that drive a single scheduler never need
+  one; see scheduler_create()
+*/
+typedef struct _scheduler_t scheduler_t;
+
+/**
+  Core speeds are given in thousandths of a nominal core, which retires one
+  unit of running time per time unit
+*/
+#define SCHEDULER_SPEED_UNIT 1000
+
+/**
+  One job of a batch passed to scheduler_new_jobs()
+*/
+typedef struct _scheduler_arrival_t
+{
+  scheduler_id_t job_number;
+  scheduler_time_t running_time;
+  int priority;
+  scheduler_time_t deadline; //absolute, or -1 for none
+} scheduler_arrival_t;
+
+/**
+  What is shed when a job arrives at a full scheduler, see
+  scheduler_set_queue_limit()
+*/
+typedef enum {ADMIT_REJECT_NEW = 0, ADMIT_DROP_LOWEST, ADMIT_DROP_OLDEST} admission_t;
+
+/**
+  Returned by scheduler_new_job() for an arriving job that was not admitted
+*/
+#define SCHEDULER_SHED -2
+
+/**
+  The latencies the scheduler keeps distributions of. The first three are
+  per job; METRIC_IO_RESPONSE is the time from an I/O completion to the
+  next dispatch, per CPU burst that follows I/O
+*/
+typedef enum {METRIC_WAITING = 0, METRIC_TURNAROUND, METRIC_RESPONSE, METRIC_IO_RESPONSE, NUM_METRICS} metric_t;
+
+/**
+  Live view of the scheduler, see scheduler_snapshot()
+*/
+typedef struct _scheduler_snapshot_t
+{
+  scheduler_time_t time;
+  long long arrived_jobs;
+  long long finished_jobs;
+  long long shed_jobs;        //not admitted, or dropped from the ready queue
+  long long in_flight_jobs;   //arrived but neither finished nor shed
+  long long queue_depth;      //jobs waiting in the ready queue(s)
+  int busy_cores;
+  double throughput;          //finished jobs per time unit so far
+  double mean_waiting_time;
+  double mean_turnaround_time;
+  double mean_response_time;
+  long long p50_waiting_time;
+  long long p99_waiting_time;
+} scheduler_snapshot_t;
+
+/**
+  The scheduler_* entry points that are timed by the statistics counters
+*/
+typedef enum {ENTRY_NEW_JOB = 0, ENTRY_NEW_JOBS, ENTRY_JOB_FINISHED, ENTRY_JOB_BLOCKED, ENTRY_JOB_UNBLOCKED, ENTRY_QUANTUM_EXPIRED, ENTRY_TIME_SLICE, NUM_ENTRIES} entry_t;
+
+/**
+  Internal counters of the scheduler. They are only maintained when the
+  library is built with SCHEDULER_STATS defined (make STATS=1); otherwise
+  the counting code is compiled out and every counter reads 0.
+*/
+typedef struct _scheduler_stats_t
+{
+  unsigned long long comparisons;      //comparator calls
+  unsigned long long offers;           //jobs put in a ready queue
+  unsigned long long polls;            //jobs taken from a ready queue
+  unsigned long long preemptions;      //running jobs displaced by a new job
+  unsigned long long quantum_requeues; //expiries that switched to another job
+  unsigned long long quantum_continues;//expiries that kept the same job
+  long long max_queue_depth;
+  double mean_queue_depth;             //sampled at every entry point call
+  unsigned long long calls[NUM_ENTRIES];
+  unsigned long long cycles[NUM_ENTRIES];
+} scheduler_stats_t;
+
+scheduler_t *scheduler_create         ();
+void  scheduler_select                 (scheduler_t *scheduler);
+void  scheduler_destroy                (scheduler_t *scheduler);
 
 void  scheduler_start_up               (int cores, scheme_t scheme);
-int   scheduler_new_job                (int job_number, int time, int running_time, int priority);
-int   scheduler_job_finished           (int core_id, int job_number, int time);
-int   scheduler_quantum_expired        (int core_id, int time);
-float scheduler_average_turnaround_time();
-float scheduler_average_waiting_time   ();
-float scheduler_average_response_time  ();
+void  scheduler_start_up_policy        (int cores, const scheduler_policy_ops *policy);
+const scheduler_policy_ops *scheduler_builtin_policy(scheme_t scheme);
+const scheduler_policy_ops *scheduler_load_policy(const char *path);
+int   scheduler_new_job                (scheduler_id_t job_number, scheduler_time_t time, scheduler_time_t running_time, int priority);
+int   scheduler_new_job_deadline       (scheduler_id_t job_number, scheduler_time_t time, scheduler_time_t running_time, int priority, scheduler_time_t deadline);
+void  scheduler_new_jobs               (scheduler_time_t time, const scheduler_arrival_t *arrivals, int count, int *cores_out);
+int   scheduler_set_submission_ring    (int capacity);
+int   scheduler_submit_job             (scheduler_id_t job_number, scheduler_time_t running_time, int priority, scheduler_time_t deadline);
+int   scheduler_drain_submissions      (scheduler_time_t time, int max, scheduler_id_t *jobs_out, int *cores_out);
+scheduler_id_t scheduler_job_finished  (int core_id, scheduler_id_t job_number, scheduler_time_t time);
+scheduler_id_t scheduler_job_blocked   (int core_id, scheduler_id_t job_number, scheduler_time_t time);
+int   scheduler_job_unblocked          (scheduler_id_t job_number, scheduler_time_t time, scheduler_time_t running_time);
+scheduler_id_t scheduler_quantum_expired(int core_id, scheduler_time_t time);
+void  scheduler_core_stalled           (int core_id, scheduler_time_t ticks);
+double scheduler_average_turnaround_time();
+double scheduler_average_waiting_time  ();
+double scheduler_average_response_time ();
+long long scheduler_deadline_jobs      ();
+long long scheduler_deadline_misses    ();
+double scheduler_deadline_miss_ratio   ();
+scheduler_time_t scheduler_lateness_percentile(double percentile);
+long long scheduler_latency_percentile (metric_t metric, double percentile);
+double scheduler_latency_mean          (metric_t metric);
+long long scheduler_class_latency_percentile(metric_t metric, int priority, double percentile);
+long long scheduler_class_jobs         (int priority);
+double scheduler_cpu_share             (int priority);
+double scheduler_entitled_share        (int priority);
+double scheduler_average_queue_length  (int core_id);
+long long scheduler_steals             (int core_id);
+scheduler_id_t scheduler_shed_job      ();
+long long scheduler_rejected_jobs      ();
+long long scheduler_dropped_jobs       ();
 void  scheduler_clean_up               ();
 
+void  scheduler_set_target_latency     (int latency);
+void  scheduler_set_adaptive_quantum   (int latency, int min_quantum);
+void  scheduler_set_per_core_queues    (int enabled);
+void  scheduler_set_affinity_window    (int window);
+void  scheduler_set_aging              (int interval);
+void  scheduler_set_core_speeds        (const int *speeds);
+void  scheduler_set_queue_limit        (int max_depth, admission_t policy);
+scheduler_time_t scheduler_time_slice  (int core_id);
+
+void  scheduler_snapshot               (scheduler_time_t time, scheduler_snapshot_t *snapshot);
 void  scheduler_show_queue             ();
+int   scheduler_stats_enabled          ();
+void  scheduler_get_stats              (scheduler_stats_t *stats_out);
+void  scheduler_policy_stats           (FILE *out);
+int   scheduler_checkpoint             (FILE *file);
+int   scheduler_restore                (FILE *file);
 
 #endif /* LIBSCHEDULER_H_ */
@@ -0,0 +1,100 @@
+/** @file policy.h
+ */
+
+#ifndef POLICY_H_
+#define POLICY_H_
+
+#include <stdio.h>
+
+/**
+  Times and durations in time units, and job numbers. Both are 64 bits wide
+  so that a trace may run past 2^31 time units or number more jobs.
+*/
+typedef long long scheduler_time_t;
+typedef long long scheduler_id_t;
+
+/**
+  A job as the scheduler keeps it. Policies read it to order jobs and may
+  update the fields they own (vruntime is free for a policy's own key). The
+  keys the built-in comparers read fill the first 64 bytes, so that a
+  comparison touches one cache line of each job.
+*/
+typedef struct _scheduler_job_t
+{
+  scheduler_id_t job_id;
+  scheduler_time_t arrival_time;
+  scheduler_time_t remaining_time;
+  scheduler_time_t deadline;
+  unsigned long long vruntime;    //the pass value under STRIDE
+  long long aged_priority;        //with aging: priority * interval + time queued
+  int priority;
+  int last_core;
+  scheduler_time_t running_time;
+
+  scheduler_time_t run_ticks;     //time units spent on a core so far
+  scheduler_time_t start_time;
+  struct _scheduler_job_io_t* io; //I/O bookkeeping, NULL until the job first blocks
+
+} scheduler_job_t;
+
+/**
+  Which data structure backs the ready queue of a policy. The tree needs a
+  comparator that is a total order (jobs are removed by comparison); the
+  heap only gives access to its top, so the affinity window and pick_next
+  see a single job.
+*/
+typedef enum {QUEUE_LIST = 0, QUEUE_TREE, QUEUE_HEAP} queue_kind_t;
+
+/**
+  The most queued jobs handed to a policy's pick_next hook.
+*/
+#define POLICY_PICK_WINDOW 8
+
+/**
+  A scheduling policy. The built-in schemes are registered as tables of
+  this type, and a shared object can provide one under the name
+  SCHEDULER_POLICY_SYMBOL for scheduler_load_policy(). Every hook may be
+  NULL, in which case the scheduler does what the built-in schemes do; the
+  built-in schemes set none of them.
+*/
+typedef struct _scheduler_policy_ops
+{
+  const char *name;
+
+  //orders the ready queue, negative when a should run before b
+  int (*compare)(const void *a, const void *b);
+  queue_kind_t queue;
+
+  //whether an arriving job may take the core of a running job
+  int preemptive;
+
+  //report the waiting time as the response time, for policies that run a
+  //job to completion once it starts
+  int response_is_wait;
+
+  //the quantum the simulator should use, 0 for no quantum
+  int quantum;
+
+  //a job becomes runnable: it arrived, was preempted, its quantum expired or
+  //its I/O completed
+  void (*enqueue)(scheduler_job_t *job, scheduler_time_t time);
+
+  //chooses which of the first count queued jobs (in queue order) runs next
+  //on core_id, returns its index
+  int (*pick_next)(const scheduler_job_t **queued, int count, int core_id, scheduler_time_t time);
+
+  //with preemptive set, whether arriving may take the core of running; must
+  //agree with compare in that a job never preempts when a better one would not
+  int (*should_preempt)(const scheduler_job_t *arriving, const scheduler_job_t *running);
+
+  //job ran for ticks time units on core_id
+  void (*on_tick)(scheduler_job_t *job, int core_id, scheduler_time_t ticks);
+
+  //prints the policy's own statistics
+  void (*stats)(FILE *out);
+
+} scheduler_policy_ops;
+
+#define SCHEDULER_POLICY_SYMBOL "scheduler_policy"
+
+#endif /* POLICY_H_ */
@@ -0,0 +1,179 @@
+/** @file mpscbench.c
+ */
+
+/*
+ * Submission throughput benchmark: producer threads submit jobs to one
+ * scheduler while a scheduler thread runs them, either through the
+ * lock-free submission ring, which the scheduler thread drains in batches,
+ * or by calling scheduler_new_job() under the mutex the scheduler thread
+ * also holds while it works.  Every job runs for one time unit on a single
+ * core and the scheduler thread finishes every job it finds.  The CFS tree
+ * queue keeps the cost of a backlog at O(log n) a job either way, so the
+ * numbers measure the hand-off rather than the queue.
+ *
+ * Usage: mpscbench [<jobs per producer> [<most producers>]]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#include "libscheduler/libscheduler.h"
+
+#define RING_CAPACITY 4096
+#define DRAIN_BATCH 256
+
+typedef struct _producer_t
+{
+	pthread_t thread;
+	scheduler_t *scheduler;
+	int first_job, jobs;
+} producer_t;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static scheduler_time_t locked_time;
+static scheduler_id_t locked_running;
+static long long locked_arrived;
+
+static double seconds_since(struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void *submit_to_ring(void *arg)
+{
+	producer_t *producer = (producer_t *)arg;
+	int i;
+
+	scheduler_select(producer->scheduler);
+	for (i = 0; i < producer->jobs; i++)
+		while (!scheduler_submit_job(producer->first_job + i, 1, 0, -1))
+			sched_yield();
+
+	return NULL;
+}
+
+/*
+ * The baseline: every producer takes the scheduler's lock to hand in a job.
+ */
+static void *submit_under_lock(void *arg)
+{
+	producer_t *producer = (producer_t *)arg;
+	int i;
+
+	scheduler_select(producer->scheduler);
+	for (i = 0; i < producer->jobs; i++)
+	{
+		pthread_mutex_lock(&lock);
+		if (scheduler_new_job(producer->first_job + i, locked_time, 1, 0) == 0)
+			locked_running = producer->first_job + i;
+		locked_arrived++;
+		pthread_mutex_unlock(&lock);
+	}
+
+	return NULL;
+}
+
+/*
+ * Returns the submissions per second of count producers.
+ */
+static double run(int count, int per_producer, int use_ring)
+{
+	producer_t *producers = malloc(count * sizeof(producer_t));
+	scheduler_t *scheduler = scheduler_create();
+	struct timespec start;
+	int i;
+
+	scheduler_select(scheduler);
+	scheduler_start_up(1, CFS);
+	if (use_ring)
+		scheduler_set_submission_ring(RING_CAPACITY);
+	locked_time = 0;
+	locked_running = -1;
+	locked_arrived = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < count; i++)
+	{
+		producers[i].scheduler = scheduler;
+		producers[i].first_job = i * per_producer;
+		producers[i].jobs = per_producer;
+		pthread_create(&producers[i].thread, NULL, use_ring ? submit_to_ring : submit_under_lock, &producers[i]);
+	}
+
+	long long total = (long long)count * per_producer;
+	if (use_ring)
+	{
+		scheduler_id_t jobs[DRAIN_BATCH], running = -1;
+		scheduler_time_t time = 0;
+		int cores[DRAIN_BATCH];
+		long long collected = 0;
+
+		while (collected < total)
+		{
+			int n = scheduler_drain_submissions(time, DRAIN_BATCH, jobs, cores);
+			if (n == 0)
+			{
+				sched_yield();
+				continue;
+			}
+			for (i = 0; i < n; i++)
+				if (cores[i] == 0)
+					running = jobs[i];
+			while (running != -1)
+				running = scheduler_job_finished(0, running, ++time);
+			collected += n;
+		}
+	}
+	else
+	{
+		int finished = 0;
+
+		while (!finished)
+		{
+			pthread_mutex_lock(&lock);
+			int idle = (locked_running == -1);
+			while (locked_running != -1)
+				locked_running = scheduler_job_finished(0, locked_running, ++locked_time);
+			finished = (locked_arrived == total);
+			pthread_mutex_unlock(&lock);
+			if (idle)
+				sched_yield();
+		}
+	}
+
+	for (i = 0; i < count; i++)
+		pthread_join(producers[i].thread, NULL);
+	double elapsed = seconds_since(&start);
+
+	scheduler_clean_up();
+	scheduler_destroy(scheduler);
+	free(producers);
+
+	return (double)count * per_producer / elapsed;
+}
+
+int main(int argc, char **argv)
+{
+	int per_producer = (argc > 1) ? atoi(argv[1]) : 100000;
+	int most = (argc > 2) ? atoi(argv[2]) : 64;
+	int count;
+
+	if (per_producer <= 0 || most <= 0)
+	{
+		fprintf(stderr, "Usage: %s [<jobs per producer> [<most producers>]]\n", argv[0]);
+		return 1;
+	}
+
+	printf("%d jobs per producer, submission ring of %d, drained %d at a time\n", per_producer, RING_CAPACITY, DRAIN_BATCH);
+	printf("Producers  ring submissions/s  locked submissions/s\n");
+	for (count = 1; count <= most; count *= 2)
+		printf("%9d  %18.0f  %20.0f\n", count, run(count, per_producer, 1), run(count, per_producer, 0));
+
+	return 0;
+}
@@ -0,0 +1,105 @@
+/** @file mpsctest.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "libmpsc/libmpsc.h"
+#include "libscheduler/libscheduler.h"
+
+#define PRODUCERS 4
+#define PER_PRODUCER 100000
+
+mpsc_t shared;
+
+void *produce(void *arg)
+{
+	int producer = (int)(long)arg;
+	int i;
+
+	for (i = 0; i < PER_PRODUCER; i++)
+	{
+		int value = producer * PER_PRODUCER + i;
+		while (!mpsc_offer(&shared, &value))
+			;
+	}
+
+	return NULL;
+}
+
+int main()
+{
+	mpsc_t q;
+	int values[8], i;
+
+	mpsc_init(&q, 3, sizeof(int));
+	printf("Capacity: %lu (expected 4).\n", q.mask + 1);
+
+	for (i = 0; i < 5; i++)
+		values[i] = 10 + i;
+	int offered = 0;
+	for (i = 0; i < 5; i++)
+		offered += mpsc_offer(&q, &values[i]);
+	printf("Offered to a ring of 4: %d (expected 4).\n", offered);
+	printf("Size: %d (expected 4).\n", mpsc_size(&q));
+
+	int out[8];
+	int drained = mpsc_drain(&q, out, 3);
+	printf("Drained: %d, %d %d %d (expected 3, 10 11 12).\n", drained, out[0], out[1], out[2]);
+
+	/* Wrap around the end of the ring. */
+	for (i = 0; i < 3; i++)
+		values[i] = 20 + i;
+	for (i = 0; i < 3; i++)
+		mpsc_offer(&q, &values[i]);
+	drained = mpsc_drain(&q, out, 8);
+	printf("Drained: %d, %d %d %d %d (expected 4, 13 20 21 22).\n", drained, out[0], out[1], out[2], out[3]);
+	printf("Drained from empty: %d (expected 0).\n", mpsc_drain(&q, out, 8));
+	mpsc_destroy(&q);
+
+	/* Producers race; each producer's values come out in its own order. */
+	pthread_t threads[PRODUCERS];
+	int last[PRODUCERS], total = 0, ordered = 1;
+	mpsc_init(&shared, 1024, sizeof(int));
+	for (i = 0; i < PRODUCERS; i++)
+	{
+		last[i] = -1;
+		pthread_create(&threads[i], NULL, produce, (void *)(long)i);
+	}
+	while (total < PRODUCERS * PER_PRODUCER)
+	{
+		int batch[256];
+		int n = mpsc_drain(&shared, batch, 256);
+		for (i = 0; i < n; i++)
+		{
+			int producer = batch[i] / PER_PRODUCER;
+			if (batch[i] % PER_PRODUCER != last[producer] + 1)
+				ordered = 0;
+			last[producer] = batch[i] % PER_PRODUCER;
+		}
+		total += n;
+	}
+	for (i = 0; i < PRODUCERS; i++)
+		pthread_join(threads[i], NULL);
+	printf("Received from %d producers: %d, in order: %d (expected %d, 1).\n", PRODUCERS, total, ordered, PRODUCERS * PER_PRODUCER);
+	mpsc_destroy(&shared);
+
+	/* Submitted jobs reach the scheduler as one batch. */
+	scheduler_id_t jobs[4];
+	int cores[4];
+	scheduler_start_up(1, SJF);
+	scheduler_set_submission_ring(4);
+	scheduler_submit_job(1, 5, 0, -1);
+	scheduler_submit_job(2, 3, 0, -1);
+	scheduler_submit_job(3, 1, 0, -1);
+	int count = scheduler_drain_submissions(0, 4, jobs, cores);
+	printf("Collected: %d, jobs %lld %lld %lld on cores %d %d %d (expected 3, jobs 1 2 3 on cores -1 -1 0).\n",
+			count, jobs[0], jobs[1], jobs[2], cores[0], cores[1], cores[2]);
+	printf("Next job: %lld (expected 2).\n", scheduler_job_finished(0, 3, 1));
+	printf("Next job: %lld (expected 1).\n", scheduler_job_finished(0, 2, 4));
+	scheduler_job_finished(0, 1, 9);
+	scheduler_clean_up();
+
+	return 0;
+}
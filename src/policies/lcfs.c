@@ -0,0 +1,47 @@
+/** @file lcfs.c
+ */
+
+/*
+ * Preemptive Last Come First Served, as an example of a scheduling policy
+ * loaded at run time:
+ *
+ *   make lcfs.so
+ *   ./simulator -c 2 -s ./lcfs.so examples/proc1.csv
+ */
+
+#include <stdio.h>
+
+#include "../libscheduler/policy.h"
+
+static int resumed;
+
+static int compareLCFS(const void *a, const void *b)
+{
+  const scheduler_job_t* job_a = (const scheduler_job_t*)a;
+  const scheduler_job_t* job_b = (const scheduler_job_t*)b;
+  if(job_a -> arrival_time != job_b -> arrival_time){
+    return (job_a -> arrival_time > job_b -> arrival_time) ? -1 : 1;
+  }
+  return (job_a -> job_id > job_b -> job_id) ? -1 : (job_a -> job_id < job_b -> job_id);
+}
+
+static void lcfs_enqueue(scheduler_job_t *job, scheduler_time_t time)
+{
+  if(job -> start_time != -1){
+    resumed++;
+  }
+}
+
+static void lcfs_stats(FILE *out)
+{
+  fprintf(out, "  LCFS jobs preempted after starting: %d\n", resumed);
+}
+
+const scheduler_policy_ops scheduler_policy = {
+  .name = "lcfs",
+  .compare = compareLCFS,
+  .queue = QUEUE_TREE,
+  .preemptive = 1,
+  .enqueue = lcfs_enqueue,
+  .stats = lcfs_stats,
+};
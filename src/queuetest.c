@@ -65,6 +65,14 @@ int main()
 		printf("%d ", *((int *)priqueue_at(&q2, i)) );
 	printf("\n");
 
+	void *batch[] = { &values[11], &values[14], &values[25], &values[40] };
+	priqueue_offer_sorted(&q, batch, 4);
+
+	printf("Elements after merging 11 14 25 40 (expected 10 11 13 14 14 20 25 30 40): ");
+	for (i = 0; i < priqueue_size(&q); i++)
+		printf("%d ", *((int *)priqueue_at(&q, i)) );
+	printf("\n");
+
 	priqueue_destroy(&q2);
 	priqueue_destroy(&q);
 
@@ -0,0 +1,246 @@
+/** @file replay.c
+ */
+
+/*
+ * Replays a decision log written by simulator -L against this build of the
+ * library: makes the logged scheduler calls with the logged arguments, in
+ * order, and checks every result against the logged one.  There is no tick
+ * loop, so a long trace replays in the time of its scheduler calls.  At the
+ * first divergent decision it prints the call, both results and the ready
+ * queue, and exits with 1.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "decisionlog.h"
+
+static const char *call_names[] = { "", "scheduler_new_jobs", "scheduler_job_finished", "scheduler_job_blocked",
+		"scheduler_job_unblocked", "scheduler_quantum_expired", "scheduler_time_slice", "scheduler_shed_job",
+		"scheduler_core_stalled" };
+
+
+void print_usage(const char *program_name)
+{
+	fprintf(stderr, "Usage: %s [-s <scheme>] <log file>\n", program_name);
+	fprintf(stderr, "  -s  replay under another scheme than the logged one: fcfs, sjf, psjf, pri,\n");
+	fprintf(stderr, "      ppri, rr, cfs, edf, pedf or stride, to find where their decisions part\n");
+}
+
+int parse_scheme(const char *name)
+{
+	const char *names[] = { "fcfs", "sjf", "psjf", "pri", "ppri", "rr", "cfs", "edf", "pedf", "stride" };
+	int i;
+
+	for (i = 0; i < 10; i++)
+		if (strcasecmp(name, names[i]) == 0)
+			return i;
+
+	return -1;
+}
+
+/*
+ * Prints the logged call of record, with its arguments.
+ */
+void print_call(log_record_t *record)
+{
+	switch (record->call)
+	{
+		case LOG_NEW_JOBS:
+			printf("%s(time %lld, %d job(s))", call_names[record->call], record->args[0], record->count);
+			break;
+
+		case LOG_JOB_FINISHED:
+		case LOG_JOB_BLOCKED:
+			printf("%s(core %lld, job %lld, time %lld)", call_names[record->call], record->args[0], record->args[1], record->args[2]);
+			break;
+
+		case LOG_JOB_UNBLOCKED:
+			printf("%s(job %lld, time %lld, running time %lld)", call_names[record->call], record->args[0], record->args[1], record->args[2]);
+			break;
+
+		case LOG_QUANTUM_EXPIRED:
+			printf("%s(core %lld, time %lld)", call_names[record->call], record->args[0], record->args[1]);
+			break;
+
+		case LOG_TIME_SLICE:
+			printf("%s(core %lld)", call_names[record->call], record->args[0]);
+			break;
+
+		case LOG_CORE_STALLED:
+			printf("%s(core %lld, %lld time unit(s))", call_names[record->call], record->args[0], record->args[1]);
+			break;
+
+		default:
+			printf("%s()", call_names[record->call]);
+			break;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	decision_log_config_t config;
+	int c, scheme = -1;
+
+	while ((c = getopt(argc, argv, "s:")) != -1)
+	{
+		switch (c)
+		{
+			case 's':
+				scheme = parse_scheme(optarg);
+
+				if (scheme == -1)
+				{
+					fprintf(stderr, "Option -s <scheme> must be one of the built-in schemes.\n");
+					print_usage(argv[0]);
+					return 1;
+				}
+				break;
+
+			default:
+				print_usage(argv[0]);
+				return 1;
+		}
+	}
+
+	if (optind != argc - 1)
+	{
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	decision_log_t *log = decision_log_open(argv[optind], &config);
+	if (log == NULL)
+	{
+		fprintf(stderr, "\"%s\" is not a readable decision log.\n", argv[optind]);
+		return 2;
+	}
+
+	/*
+	 * Set the scheduler up as the simulator did.
+	 */
+	if (scheme != -1)
+		scheduler_start_up(config.cores, scheme);
+	else if (config.policy_file != NULL)
+	{
+		const scheduler_policy_ops *policy = scheduler_load_policy(config.policy_file);
+		if (policy == NULL)
+		{
+			fprintf(stderr, "Unable to load the logged policy from \"%s\".\n", config.policy_file);
+			return 2;
+		}
+		scheduler_start_up_policy(config.cores, policy);
+	}
+	else
+		scheduler_start_up(config.cores, config.scheme);
+	if (config.latency > 0)
+		scheduler_set_target_latency(config.latency);
+	if (config.per_core_queues)
+		scheduler_set_per_core_queues(1);
+	if (config.affinity_window)
+		scheduler_set_affinity_window(config.affinity_window);
+	if (config.aging_interval)
+		scheduler_set_aging(config.aging_interval);
+	if (config.adaptive_latency > 0)
+		scheduler_set_adaptive_quantum(config.adaptive_latency, config.adaptive_floor);
+	if (config.core_speeds != NULL)
+		scheduler_set_core_speeds(config.core_speeds);
+	if (config.queue_limit >= 0)
+		scheduler_set_queue_limit(config.queue_limit, config.admission);
+
+	/*
+	 * Replay.
+	 */
+	struct timespec start, end;
+	log_record_t *record;
+	int *cores = NULL, capacity = 0, diverged = 0, i;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	while (!diverged && (record = decision_log_read(log)) != NULL)
+	{
+		long long result = 0;
+
+		switch (record->call)
+		{
+			case LOG_NEW_JOBS:
+				if (record->count > capacity)
+				{
+					capacity = record->count;
+					cores = realloc(cores, capacity * sizeof(int));
+				}
+				scheduler_new_jobs(record->args[0], record->arrivals, record->count, cores);
+				for (i = 0; i < record->count; i++)
+					if (cores[i] != record->cores[i])
+					{
+						printf("Divergence at call %lld: ", log->records);
+						print_call(record);
+						printf(" put job %lld on core %d, the log says %d.\n",
+								record->arrivals[i].job_number, cores[i], record->cores[i]);
+						diverged = 1;
+						break;
+					}
+				continue;
+
+			case LOG_JOB_FINISHED:
+				result = scheduler_job_finished(record->args[0], record->args[1], record->args[2]);
+				break;
+
+			case LOG_JOB_BLOCKED:
+				result = scheduler_job_blocked(record->args[0], record->args[1], record->args[2]);
+				break;
+
+			case LOG_JOB_UNBLOCKED:
+				result = scheduler_job_unblocked(record->args[0], record->args[1], record->args[2]);
+				break;
+
+			case LOG_QUANTUM_EXPIRED:
+				result = scheduler_quantum_expired(record->args[0], record->args[1]);
+				break;
+
+			case LOG_TIME_SLICE:
+				result = scheduler_time_slice(record->args[0]);
+				break;
+
+			case LOG_SHED_JOB:
+				result = scheduler_shed_job();
+				break;
+
+			case LOG_CORE_STALLED:
+				scheduler_core_stalled(record->args[0], record->args[1]);
+				break;
+		}
+
+		if (result != record->result)
+		{
+			printf("Divergence at call %lld: ", log->records);
+			print_call(record);
+			printf(" returned %lld, the log says %lld.\n", result, record->result);
+			diverged = 1;
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	if (diverged)
+	{
+		printf("Queue:\n");
+		scheduler_show_queue();
+		printf("\n");
+	}
+	else if (log->truncated)
+		printf("The log ends in the middle of call %lld; the %lld calls before it agree.\n", log->records + 1, log->records);
+	else
+		printf("Replayed %lld scheduler calls in %.3f s: every decision matches the log.\n", log->records,
+				(end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+
+	scheduler_clean_up();
+	decision_log_close(log);
+	decision_log_free_config(&config);
+	free(cores);
+
+	return diverged;
+}
@@ -0,0 +1,344 @@
+/** @file schedd.c
+ */
+
+/*
+ * Serves one scheduler to other local processes over a Unix domain socket,
+ * as described in schedservice.h.  Every connection gets a thread, and the
+ * calls of all of them go to the scheduler one at a time.  A connection
+ * that asks for the shared rings is served from them until it detaches or
+ * hangs up.  The daemon keeps track of the job on every core, so that a
+ * call about an idle core or a job that is not running is refused with
+ * SERVICE_INVALID rather than corrupting the scheduler.  SIGINT and SIGTERM
+ * remove the socket and stop the daemon.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "schedservice.h"
+
+pthread_mutex_t scheduler_lock = PTHREAD_MUTEX_INITIALIZER;
+scheduler_id_t *core_job;
+scheduler_time_t latest_time = 0;
+int cores;
+
+volatile sig_atomic_t stopping = 0;
+
+
+void print_usage(const char *program_name)
+{
+	fprintf(stderr, "Usage: %s -c <cores> -s <scheme> <socket path>\n", program_name);
+	fprintf(stderr, "Acceptable schemes are: fcfs, sjf, psjf, pri, ppri, rr, cfs[#], edf, pedf, stride\n");
+	fprintf(stderr, "  (the number after cfs is the target latency, default 8)\n");
+	fprintf(stderr, "  or the path of a shared object ending in .so that defines a scheduler_policy\n");
+}
+
+int parse_scheme(const char *name)
+{
+	const char *names[] = { "fcfs", "sjf", "psjf", "pri", "ppri", "rr", "cfs", "edf", "pedf", "stride" };
+	int i;
+
+	for (i = 0; i < 10; i++)
+		if (strncasecmp(name, names[i], strlen(names[i])) == 0 && (name[strlen(names[i])] == '\0' || i == CFS))
+			return i;
+
+	return -1;
+}
+
+/*
+ * Makes the call of request and fills in reply.  The caller holds the
+ * scheduler lock.
+ */
+void answer(const service_request_t *request, service_reply_t *reply)
+{
+	const long long *args = request->args;
+	int core_id = (int)args[0];
+	int valid_core = (args[0] >= 0 && args[0] < cores);
+
+	reply->result = SERVICE_INVALID;
+	switch (request->call)
+	{
+		case SERVICE_NEW_JOB:
+			if (args[0] < 0 || args[1] < latest_time || args[2] <= 0)
+				break;
+			latest_time = args[1];
+			reply->result = scheduler_new_job_deadline(args[0], args[1], args[2], (int)args[3], args[4]);
+			if (reply->result >= 0)
+				core_job[reply->result] = args[0];
+			break;
+
+		case SERVICE_JOB_FINISHED:
+			if (!valid_core || core_job[core_id] != args[1] || args[1] == -1 || args[2] < latest_time)
+				break;
+			latest_time = args[2];
+			reply->result = scheduler_job_finished(core_id, args[1], args[2]);
+			core_job[core_id] = reply->result;
+			break;
+
+		case SERVICE_QUANTUM_EXPIRED:
+			if (!valid_core || core_job[core_id] == -1 || args[1] < latest_time)
+				break;
+			latest_time = args[1];
+			reply->result = scheduler_quantum_expired(core_id, args[1]);
+			core_job[core_id] = reply->result;
+			break;
+
+		case SERVICE_SNAPSHOT:
+			scheduler_snapshot((args[0] < latest_time) ? latest_time : args[0], &reply->snapshot);
+			reply->result = 0;
+			break;
+
+		case SERVICE_PERCENTILE:
+			if (args[0] < 0 || args[0] >= NUM_METRICS || !(request->percentile >= 0 && request->percentile <= 100))
+				break;
+			reply->result = scheduler_latency_percentile((metric_t)args[0], request->percentile);
+			break;
+
+		case SERVICE_STATS:
+			scheduler_get_stats(&reply->stats);
+			reply->result = scheduler_stats_enabled();
+			break;
+
+		default:
+			break;
+	}
+}
+
+/*
+ * Creates the rings of a connection and sends their file descriptor back
+ * as the reply to SERVICE_ATTACH_RING.  Returns them mapped, or NULL.
+ */
+service_shared_t *attach_ring(int connection)
+{
+	long long result = -1;
+	struct iovec data = { &result, sizeof(result) };
+	struct msghdr message = { .msg_iov = &data, .msg_iovlen = 1 };
+	char control[CMSG_SPACE(sizeof(int))];
+	service_shared_t *shared = MAP_FAILED;
+
+	int fd = memfd_create("schedd-rings", MFD_CLOEXEC);
+	if (fd != -1 && ftruncate(fd, sizeof(service_shared_t)) == 0)
+		shared = mmap(NULL, sizeof(service_shared_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+	if (shared != MAP_FAILED)
+	{
+		result = 0;
+		message.msg_control = control;
+		message.msg_controllen = sizeof(control);
+		struct cmsghdr *header = CMSG_FIRSTHDR(&message);
+		header->cmsg_level = SOL_SOCKET;
+		header->cmsg_type = SCM_RIGHTS;
+		header->cmsg_len = CMSG_LEN(sizeof(int));
+		memcpy(CMSG_DATA(header), &fd, sizeof(int));
+	}
+
+	int sent = (sendmsg(connection, &message, MSG_NOSIGNAL) == sizeof(result));
+	if (fd != -1)
+		close(fd);
+	if (shared != MAP_FAILED && !sent)
+	{
+		munmap(shared, sizeof(service_shared_t));
+		return NULL;
+	}
+	return (shared != MAP_FAILED) ? shared : NULL;
+}
+
+/*
+ * Answers the requests of one attached client from its rings until it
+ * detaches or goes away.
+ */
+void serve_ring(int connection, service_shared_t *shared)
+{
+	service_request_t request;
+	service_reply_t reply;
+
+	while (service_ring_get(&shared->requests, shared->request_slots, sizeof(service_request_t), &request, connection) &&
+			request.call != SERVICE_DETACH_RING)
+	{
+		if (request.call == SERVICE_ATTACH_RING)
+			reply.result = SERVICE_INVALID;
+		else
+		{
+			pthread_mutex_lock(&scheduler_lock);
+			answer(&request, &reply);
+			pthread_mutex_unlock(&scheduler_lock);
+		}
+		service_ring_put(&shared->replies, shared->reply_slots, sizeof(service_reply_t), &reply);
+	}
+	munmap(shared, sizeof(service_shared_t));
+}
+
+void *serve_connection(void *arg)
+{
+	int connection = (int)(long)arg;
+	service_request_t request;
+	service_reply_t reply;
+
+	while (recv(connection, &request, sizeof(request), 0) == sizeof(request))
+	{
+		if (request.call == SERVICE_ATTACH_RING)
+		{
+			service_shared_t *shared = attach_ring(connection);
+			if (shared != NULL)
+			{
+				serve_ring(connection, shared);
+				break;
+			}
+			continue;
+		}
+
+		if (request.call == SERVICE_DETACH_RING)
+			reply.result = SERVICE_INVALID;
+		else
+		{
+			pthread_mutex_lock(&scheduler_lock);
+			answer(&request, &reply);
+			pthread_mutex_unlock(&scheduler_lock);
+		}
+		if (send(connection, &reply, service_reply_size(request.call), MSG_NOSIGNAL) == -1)
+			break;
+	}
+
+	close(connection);
+	return NULL;
+}
+
+void stop(int signal_number)
+{
+	(void)signal_number;
+	stopping = 1;
+}
+
+int main(int argc, char **argv)
+{
+	const char *scheme_name = NULL;
+	int c;
+
+	while ((c = getopt(argc, argv, "c:s:")) != -1)
+	{
+		switch (c)
+		{
+			case 'c':
+				cores = atoi(optarg);
+				break;
+
+			case 's':
+				scheme_name = optarg;
+				break;
+
+			default:
+				print_usage(argv[0]);
+				return 1;
+		}
+	}
+
+	if (optind != argc - 1 || cores <= 0 || scheme_name == NULL)
+	{
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	/*
+	 * Set the scheduler up.
+	 */
+	size_t length = strlen(scheme_name);
+	int scheme = parse_scheme(scheme_name);
+	if (length > 3 && strcmp(scheme_name + length - 3, ".so") == 0)
+	{
+		const scheduler_policy_ops *policy = scheduler_load_policy(scheme_name);
+		if (policy == NULL)
+		{
+			fprintf(stderr, "Unable to load a policy from \"%s\".\n", scheme_name);
+			return 2;
+		}
+		scheduler_start_up_policy(cores, policy);
+	}
+	else if (scheme != -1 && (scheme != CFS || scheme_name[3] == '\0' || atoi(scheme_name + 3) > 0))
+	{
+		scheduler_start_up(cores, scheme);
+		if (scheme == CFS && scheme_name[3] != '\0')
+			scheduler_set_target_latency(atoi(scheme_name + 3));
+	}
+	else
+	{
+		fprintf(stderr, "Unknown scheme \"%s\".\n", scheme_name);
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	core_job = malloc(cores * sizeof(scheduler_id_t));
+	for (c = 0; c < cores; c++)
+		core_job[c] = -1;
+
+	/*
+	 * Listen, replacing the socket of a daemon that did not clean up.
+	 */
+	const char *path = argv[optind];
+	struct sockaddr_un address = { .sun_family = AF_UNIX };
+	struct stat status;
+
+	if (strlen(path) >= sizeof(address.sun_path))
+	{
+		fprintf(stderr, "The socket path \"%s\" is too long.\n", path);
+		return 1;
+	}
+	strcpy(address.sun_path, path);
+	if (stat(path, &status) == 0 && S_ISSOCK(status.st_mode))
+		unlink(path);
+
+	int listener = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+	if (listener == -1 || bind(listener, (struct sockaddr *)&address, sizeof(address)) == -1 || listen(listener, 16) == -1)
+	{
+		fprintf(stderr, "Unable to listen on \"%s\": %s.\n", path, strerror(errno));
+		return 2;
+	}
+
+	// Without SA_RESTART, so that a signal interrupts accept()
+	struct sigaction action = { .sa_handler = stop };
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+
+	// Only the main thread takes them
+	sigset_t stop_signals, old_mask;
+	sigemptyset(&stop_signals);
+	sigaddset(&stop_signals, SIGINT);
+	sigaddset(&stop_signals, SIGTERM);
+
+	printf("Serving %s on %d core(s) at %s\n", scheme_name, cores, path);
+	fflush(stdout);
+
+	while (!stopping)
+	{
+		int connection = accept(listener, NULL, NULL);
+		if (connection == -1)
+		{
+			if (errno != EINTR)
+				fprintf(stderr, "accept: %s\n", strerror(errno));
+			continue;
+		}
+
+		pthread_t thread;
+		pthread_sigmask(SIG_BLOCK, &stop_signals, &old_mask);
+		if (pthread_create(&thread, NULL, serve_connection, (void *)(long)connection) == 0)
+			pthread_detach(thread);
+		else
+			close(connection);
+		pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+	}
+
+	close(listener);
+	unlink(path);
+
+	return 0;
+}
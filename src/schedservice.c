@@ -0,0 +1,239 @@
+/** @file schedservice.c
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+
+#include "schedservice.h"
+
+// Polls of an empty ring before the consumer sleeps, and how long it sleeps
+// before checking that the other end is still connected
+#define SERVICE_SPINS 200
+#define SERVICE_NAP_NS 100000000
+
+/*
+ * Returns the bytes of the reply to call: the union only follows the result
+ * for the calls that fill it.
+ */
+size_t service_reply_size(service_call_t call)
+{
+	switch (call)
+	{
+		case SERVICE_SNAPSHOT:
+			return offsetof(service_reply_t, snapshot) + sizeof(scheduler_snapshot_t);
+		case SERVICE_STATS:
+			return offsetof(service_reply_t, stats) + sizeof(scheduler_stats_t);
+		default:
+			return sizeof(long long);
+	}
+}
+
+/*
+ * Returns 1 if the other end of socket hung up, or sent something on it
+ * while it talks through the rings, which ends the conversation as well.
+ */
+static int peer_gone(int socket)
+{
+	struct pollfd fd = { socket, POLLIN, 0 };
+	return poll(&fd, 1, 0) != 0;
+}
+
+/*
+ * Copies elem into the next slot of ring and wakes the consumer if it
+ * sleeps.  Returns 0 if the ring is full.
+ */
+int service_ring_put(service_ring_t *ring, void *slots, size_t slot_size, const void *elem)
+{
+	unsigned int head = ring->head;
+
+	if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) == SERVICE_RING_SLOTS)
+		return 0;
+
+	memcpy((char *)slots + (head & (SERVICE_RING_SLOTS - 1)) * slot_size, elem, slot_size);
+
+	// Publishing head and then reading waiting pairs with the consumer setting
+	// waiting and then reading head: one of the two sees the other
+	__atomic_store_n(&ring->head, head + 1, __ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&ring->waiting, __ATOMIC_SEQ_CST))
+		syscall(SYS_futex, &ring->head, FUTEX_WAKE, 1, NULL, NULL, 0);
+	return 1;
+}
+
+/*
+ * Copies the next element of ring into elem, waiting for one: first by
+ * polling, then asleep.  Returns 0 if the other end of socket went away
+ * while the ring was empty.
+ */
+int service_ring_get(service_ring_t *ring, void *slots, size_t slot_size, void *elem, int socket)
+{
+	unsigned int tail = ring->tail;
+	int spins = 0;
+
+	while (__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == tail)
+	{
+		if (++spins < SERVICE_SPINS)
+			continue;
+
+		struct timespec nap = { 0, SERVICE_NAP_NS };
+		__atomic_store_n(&ring->waiting, 1, __ATOMIC_SEQ_CST);
+		if (__atomic_load_n(&ring->head, __ATOMIC_SEQ_CST) == tail &&
+				syscall(SYS_futex, &ring->head, FUTEX_WAIT, tail, &nap, NULL, 0) == -1 && errno == ETIMEDOUT &&
+				peer_gone(socket))
+		{
+			__atomic_store_n(&ring->waiting, 0, __ATOMIC_RELAXED);
+			return 0;
+		}
+		__atomic_store_n(&ring->waiting, 0, __ATOMIC_RELAXED);
+	}
+
+	memcpy(elem, (char *)slots + (tail & (SERVICE_RING_SLOTS - 1)) * slot_size, slot_size);
+	__atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+	return 1;
+}
+
+/**
+  Connects client to the daemon listening on the socket at path.
+
+  @return 0 on success, -1 if there is no daemon there
+ */
+int service_connect(service_client_t *client, const char *path)
+{
+	struct sockaddr_un address = { .sun_family = AF_UNIX };
+
+	memset(client, 0, sizeof(service_client_t));
+	if (strlen(path) >= sizeof(address.sun_path))
+		return -1;
+	strcpy(address.sun_path, path);
+
+	client->socket = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+	if (client->socket == -1)
+		return -1;
+	if (connect(client->socket, (struct sockaddr *)&address, sizeof(address)) == -1)
+	{
+		close(client->socket);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+  Moves client's calls from the socket to rings shared with the daemon.
+  No call may be outstanding.
+
+  @return 0 on success, -1 if the daemon could not set them up
+ */
+int service_attach_ring(service_client_t *client)
+{
+	service_request_t request = { .call = SERVICE_ATTACH_RING };
+	long long result;
+	char control[CMSG_SPACE(sizeof(int))];
+	struct iovec data = { &result, sizeof(result) };
+	struct msghdr message = { .msg_iov = &data, .msg_iovlen = 1, .msg_control = control, .msg_controllen = sizeof(control) };
+
+	if (client->sent != client->received || send(client->socket, &request, sizeof(request), MSG_NOSIGNAL) != sizeof(request))
+		return -1;
+	if (recvmsg(client->socket, &message, 0) != sizeof(result) || result != 0)
+		return -1;
+
+	struct cmsghdr *header = CMSG_FIRSTHDR(&message);
+	if (header == NULL || header->cmsg_type != SCM_RIGHTS)
+		return -1;
+
+	int fd;
+	memcpy(&fd, CMSG_DATA(header), sizeof(int));
+	client->shared = mmap(NULL, sizeof(service_shared_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (client->shared == MAP_FAILED)
+	{
+		client->shared = NULL;
+		return -1;
+	}
+	return 0;
+}
+
+/**
+  Sends request without waiting for its reply, so that several calls can be
+  in flight; their replies come back in order.  At most SERVICE_RING_SLOTS
+  calls may be outstanding.
+
+  @return 0 on success, -1 if the daemon went away or too many calls are
+  outstanding
+ */
+int service_send(service_client_t *client, const service_request_t *request)
+{
+	if (client->sent - client->received == SERVICE_RING_SLOTS)
+		return -1;
+
+	if (client->shared != NULL)
+	{
+		if (!service_ring_put(&client->shared->requests, client->shared->request_slots, sizeof(service_request_t), request))
+			return -1;
+	}
+	else if (send(client->socket, request, sizeof(service_request_t), MSG_NOSIGNAL) != sizeof(service_request_t))
+		return -1;
+
+	client->pending[client->sent++ & (SERVICE_RING_SLOTS - 1)] = request->call;
+	return 0;
+}
+
+/**
+  Waits for the reply to the earliest outstanding call.
+
+  @return 0 on success, -1 if the daemon went away or no call is outstanding
+ */
+int service_receive(service_client_t *client, service_reply_t *reply)
+{
+	if (client->sent == client->received)
+		return -1;
+
+	service_call_t call = client->pending[client->received & (SERVICE_RING_SLOTS - 1)];
+	if (client->shared != NULL)
+	{
+		if (!service_ring_get(&client->shared->replies, client->shared->reply_slots, sizeof(service_reply_t), reply, client->socket))
+			return -1;
+	}
+	else if (recv(client->socket, reply, sizeof(service_reply_t), 0) != (ssize_t)service_reply_size(call))
+		return -1;
+
+	client->received++;
+	return 0;
+}
+
+/**
+  Makes one call and waits for its reply.
+
+  @return 0 on success, -1 if the daemon went away
+ */
+int service_call(service_client_t *client, const service_request_t *request, service_reply_t *reply)
+{
+	if (service_send(client, request) == -1)
+		return -1;
+	return service_receive(client, reply);
+}
+
+/**
+  Leaves the rings, if attached, and disconnects.
+ */
+void service_close(service_client_t *client)
+{
+	if (client->shared != NULL)
+	{
+		service_request_t request = { .call = SERVICE_DETACH_RING };
+		service_ring_put(&client->shared->requests, client->shared->request_slots, sizeof(service_request_t), &request);
+		munmap(client->shared, sizeof(service_shared_t));
+		client->shared = NULL;
+	}
+	close(client->socket);
+}
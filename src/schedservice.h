@@ -0,0 +1,97 @@
+/** @file schedservice.h
+ */
+
+#ifndef SCHEDSERVICE_H_
+#define SCHEDSERVICE_H_
+
+#include "libscheduler/libscheduler.h"
+
+/*
+ * The scheduler service lets local processes drive the one scheduler of a
+ * schedd daemon without linking the library.  Every call is a request and
+ * a reply, carried either by the daemon's Unix domain socket, one message
+ * each, or by a pair of single-producer single-consumer rings in memory the
+ * daemon shares with a client that asks for them, which saves the system
+ * calls of a busy client.  Requests and replies travel as they are laid out
+ * in memory, so both ends must be built from the same headers.
+ */
+
+#define SERVICE_RING_SLOTS 256        // a power of two
+#define SERVICE_CACHE_LINE 64
+
+/**
+  Returned instead of a result for a request the scheduler cannot take: a
+  core out of range or idle, a job that is not running on the core, or a
+  time earlier than one the daemon was already given
+*/
+#define SERVICE_INVALID -3
+
+typedef enum
+{
+	SERVICE_NEW_JOB = 1,          // job, time, running time, priority, deadline (-1 for none) -> core, -1 or SCHEDULER_SHED
+	SERVICE_JOB_FINISHED,         // core, job, time -> the core's next job or -1
+	SERVICE_QUANTUM_EXPIRED,      // core, time -> the core's next job
+	SERVICE_SNAPSHOT,             // time, taken as the latest time seen if earlier -> 0 and snapshot
+	SERVICE_PERCENTILE,           // metric, and percentile -> the latency at that percentile
+	SERVICE_STATS,                // -> scheduler_stats_enabled() and stats
+	SERVICE_ATTACH_RING,          // socket only -> 0 and the rings' file descriptor, or -1
+	SERVICE_DETACH_RING           // ring only, no reply: the client is leaving
+} service_call_t;
+
+typedef struct _service_request_t
+{
+	service_call_t call;
+	long long args[5];
+	double percentile;
+} service_request_t;
+
+typedef struct _service_reply_t
+{
+	long long result;
+	union
+	{
+		scheduler_snapshot_t snapshot;
+		scheduler_stats_t stats;
+	};
+} service_reply_t;
+
+/*
+ * One direction of the shared rings.  Positions only grow and wrap around
+ * with unsigned arithmetic; the consumer sleeps on head in a futex when it
+ * runs out of slots, after telling the producer through waiting.
+ */
+typedef struct _service_ring_t
+{
+	unsigned int head __attribute__((aligned(SERVICE_CACHE_LINE)));   // slots written
+	unsigned int waiting;                                             // the consumer sleeps on head
+	unsigned int tail __attribute__((aligned(SERVICE_CACHE_LINE)));   // slots read
+} service_ring_t;
+
+typedef struct _service_shared_t
+{
+	service_ring_t requests;
+	service_ring_t replies;
+	service_request_t request_slots[SERVICE_RING_SLOTS];
+	service_reply_t reply_slots[SERVICE_RING_SLOTS];
+} service_shared_t;
+
+typedef struct _service_client_t
+{
+	int socket;
+	service_shared_t *shared;     // NULL until service_attach_ring()
+	service_call_t pending[SERVICE_RING_SLOTS];
+	unsigned int sent, received;  // requests sent and replies received
+} service_client_t;
+
+size_t service_reply_size(service_call_t call);
+int service_ring_put(service_ring_t *ring, void *slots, size_t slot_size, const void *elem);
+int service_ring_get(service_ring_t *ring, void *slots, size_t slot_size, void *elem, int socket);
+
+int service_connect(service_client_t *client, const char *path);
+int service_attach_ring(service_client_t *client);
+int service_send(service_client_t *client, const service_request_t *request);
+int service_receive(service_client_t *client, service_reply_t *reply);
+int service_call(service_client_t *client, const service_request_t *request, service_reply_t *reply);
+void service_close(service_client_t *client);
+
+#endif /* SCHEDSERVICE_H_ */
@@ -0,0 +1,232 @@
+/** @file servicebench.c
+ */
+
+/*
+ * Scheduler service benchmark: drives a running schedd over its socket and
+ * over the shared rings, and reports for each the round trip of a call made
+ * alone and the calls per second of a client that keeps up to <window>
+ * calls in flight.  Every job arrives on an idle scheduler, has its quantum
+ * expire and finishes, so every result is known in advance and is checked;
+ * the scheduler must be idle when the benchmark starts.  It ends with the
+ * daemon's statistics, read through the service as well.
+ *
+ * Usage: servicebench <socket path> [<calls> [<window>]]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "schedservice.h"
+#include "libhistogram/libhistogram.h"
+
+typedef struct _workload_t
+{
+	scheduler_id_t next_job;
+	scheduler_time_t time;
+	int core;
+	long long calls;
+} workload_t;
+
+static long long nanoseconds(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+/*
+ * Fills in the next call of the workload and returns the result it must
+ * get: a job arrives, has its quantum expire and finishes, all on one core.
+ */
+static long long next_call(workload_t *workload, service_request_t *request)
+{
+	request->percentile = 0;
+	switch (workload->calls++ % 3)
+	{
+		case 0:
+			request->call = SERVICE_NEW_JOB;
+			request->args[0] = workload->next_job;
+			request->args[1] = workload->time;
+			request->args[2] = 1;
+			request->args[3] = 0;
+			request->args[4] = -1;
+			return workload->core;
+
+		case 1:
+			request->call = SERVICE_QUANTUM_EXPIRED;
+			request->args[0] = workload->core;
+			request->args[1] = workload->time;
+			return workload->next_job;
+
+		default:
+			request->call = SERVICE_JOB_FINISHED;
+			request->args[0] = workload->core;
+			request->args[1] = workload->next_job++;
+			request->args[2] = ++workload->time;
+			return -1;
+	}
+}
+
+/*
+ * Starts the workload where the scheduler is: after the jobs it has seen,
+ * at its time, and on the core it gives an arrival on an idle scheduler.
+ * Returns 0 if the scheduler is not idle or the daemon does not answer.
+ */
+static int start_workload(service_client_t *client, workload_t *workload)
+{
+	service_request_t request = { .call = SERVICE_SNAPSHOT };
+	service_reply_t reply;
+	int i;
+
+	if (service_call(client, &request, &reply) == -1 || reply.snapshot.in_flight_jobs != 0)
+		return 0;
+
+	workload->next_job = reply.snapshot.arrived_jobs;
+	workload->time = reply.snapshot.time;
+	workload->calls = 0;
+	workload->core = -1;
+
+	for (i = 0; i < 3; i++)
+	{
+		long long expected = next_call(workload, &request);
+		if (service_call(client, &request, &reply) == -1 || (i > 0 && reply.result != expected) || (i == 0 && reply.result < 0))
+			return 0;
+		if (i == 0)
+			workload->core = (int)reply.result;
+	}
+	return 1;
+}
+
+/*
+ * Runs calls calls of the workload with up to window of them in flight,
+ * timing each alone when window is 1.  Returns the elapsed nanoseconds, or
+ * -1 if a call failed or got another result than expected.
+ */
+static long long run(service_client_t *client, workload_t *workload, long long calls, int window, histogram_t *round_trips)
+{
+	long long expected[SERVICE_RING_SLOTS];
+	service_request_t request;
+	service_reply_t reply;
+	long long sent = 0, received = 0;
+	long long start = nanoseconds();
+
+	while (received < calls)
+	{
+		if (sent < calls && sent - received < window)
+		{
+			long long call_start = nanoseconds();
+			expected[sent++ % SERVICE_RING_SLOTS] = next_call(workload, &request);
+			if (service_send(client, &request) == -1)
+				return -1;
+			if (window > 1)
+				continue;
+
+			if (service_receive(client, &reply) == -1)
+				return -1;
+			if (round_trips != NULL)
+				histogram_record(round_trips, nanoseconds() - call_start);
+		}
+		else if (service_receive(client, &reply) == -1)
+			return -1;
+
+		if (reply.result != expected[received++ % SERVICE_RING_SLOTS])
+		{
+			fprintf(stderr, "Call %lld returned %lld, expected %lld.\n", received, reply.result, expected[(received - 1) % SERVICE_RING_SLOTS]);
+			return -1;
+		}
+	}
+
+	return nanoseconds() - start;
+}
+
+/*
+ * Measures one transport on a connection of its own.  Returns 0 on error.
+ */
+static int measure(const char *path, int use_ring, long long calls, int window)
+{
+	service_client_t client;
+	workload_t workload;
+	histogram_t round_trips;
+
+	if (service_connect(&client, path) == -1)
+	{
+		fprintf(stderr, "No scheduler service at \"%s\".\n", path);
+		return 0;
+	}
+	if (use_ring && service_attach_ring(&client) == -1)
+	{
+		fprintf(stderr, "The daemon did not hand out its shared rings.\n");
+		service_close(&client);
+		return 0;
+	}
+	if (!start_workload(&client, &workload))
+	{
+		fprintf(stderr, "The scheduler must be idle, with an idle core, to run the benchmark.\n");
+		service_close(&client);
+		return 0;
+	}
+
+	histogram_init(&round_trips);
+	long long alone = run(&client, &workload, calls, 1, &round_trips);
+	long long pipelined = (alone == -1) ? -1 : run(&client, &workload, calls, window, NULL);
+	service_close(&client);
+	if (pipelined == -1)
+		return 0;
+
+	printf("%-9s  %7.0f  %7llu  %7llu  %9.0f  %15.0f\n", use_ring ? "ring" : "socket",
+			histogram_mean(&round_trips), histogram_percentile(&round_trips, 50), histogram_percentile(&round_trips, 99),
+			calls * 1e9 / alone, calls * 1e9 / pipelined);
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	long long calls = (argc > 2) ? atoll(argv[2]) : 300000;
+	int window = (argc > 3) ? atoi(argv[3]) : 64;
+
+	if (argc < 2 || argc > 4 || calls <= 0 || window <= 0 || window > SERVICE_RING_SLOTS)
+	{
+		fprintf(stderr, "Usage: %s <socket path> [<calls> [<window>]]\n", argv[0]);
+		fprintf(stderr, "  (at most %d calls in flight)\n", SERVICE_RING_SLOTS);
+		return 1;
+	}
+
+	// Whole jobs, so that each run leaves the scheduler idle
+	calls += (3 - calls % 3) % 3;
+
+	printf("%lld calls per run, up to %d in flight when pipelined\n", calls, window);
+	printf("Transport  round trip ns: mean      p50      p99  calls/s alone  calls/s pipelined\n");
+	if (!measure(argv[1], 0, calls, window) || !measure(argv[1], 1, calls, window))
+		return 2;
+
+	/*
+	 * The statistics calls.
+	 */
+	service_client_t client;
+	service_request_t request = { .call = SERVICE_SNAPSHOT };
+	service_reply_t reply;
+
+	if (service_connect(&client, argv[1]) == -1 || service_call(&client, &request, &reply) == -1)
+		return 2;
+	printf("Scheduler: %lld jobs finished by time %lld, mean turnaround %.2f", reply.snapshot.finished_jobs,
+			reply.snapshot.time, reply.snapshot.mean_turnaround_time);
+
+	request.call = SERVICE_PERCENTILE;
+	request.args[0] = METRIC_TURNAROUND;
+	request.percentile = 99;
+	if (service_call(&client, &request, &reply) == -1)
+		return 2;
+	printf(", p99 %lld", reply.result);
+
+	request.call = SERVICE_STATS;
+	if (service_call(&client, &request, &reply) == -1)
+		return 2;
+	if (reply.result)
+		printf(", %llu comparisons", reply.stats.comparisons);
+	printf("\n");
+	service_close(&client);
+
+	return 0;
+}
@@ -6,122 +6,1125 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <getopt.h>
 #include <string.h>
 #include <assert.h>
 
 #include "libscheduler/libscheduler.h"
+#include "libscheduler/cycles.h"
+#include "libcalqueue/libcalqueue.h"
+#include "cluster.h"
+#include "executor.h"
+#include "decisionlog.h"
 
 
 typedef struct _simulator_job_list_t
 {
-	int job_id, arrival_time, run_time, priority;
+	scheduler_id_t job_id;
+	scheduler_time_t arrival_time, run_time, deadline;
+	scheduler_time_t *bursts;             // CPU, I/O, CPU, ... bursts
+	int priority;
 	int core_id, arrived;
+	int last_core, warmup;
+	int burst_count, next_burst;
+	int blocked;
 } simulator_job_list_t;
 
+/*
+ * A future event: a job arriving, or completing its I/O.  Jobs block for
+ * I/O independently of each other, as if every job had a device of its own.
+ */
+typedef enum { EVENT_ARRIVAL, EVENT_IO_DONE } event_kind_t;
+
+typedef struct _event_t
+{
+	scheduler_time_t time;
+	scheduler_id_t job_id;
+	event_kind_t kind;
+} event_t;
+
+long long event_time(const void *event)
+{
+	return ((const event_t *)event)->time;
+}
+
+void push_event(calqueue_t *future_events, scheduler_time_t time, scheduler_id_t job_id, event_kind_t kind)
+{
+	event_t *event = malloc(sizeof(event_t));
+	event->time = time;
+	event->job_id = job_id;
+	event->kind = kind;
+	calqueue_push(future_events, event);
+}
+
+int compare_ids(const void *a, const void *b)
+{
+	scheduler_id_t id_a = *(const scheduler_id_t *)a, id_b = *(const scheduler_id_t *)b;
+	return (id_a > id_b) - (id_a < id_b);
+}
+
+int compare_indices(const void *a, const void *b)
+{
+	return *(const int *)a - *(const int *)b;
+}
+
+/*
+ * Where each job is in jobs[] by job number (-1 once it left), and the job
+ * running on each core (-1 when idle), so that the tick loop reaches the
+ * jobs it needs without scanning jobs[].
+ */
+int *job_index = NULL;
+scheduler_id_t num_job_ids = 0;
+scheduler_id_t *core_job = NULL;
+
+void index_jobs(simulator_job_list_t *jobs, int active_jobs, int cores)
+{
+	int i;
+
+	for (i = 0; i < num_job_ids; i++)
+		job_index[i] = -1;
+	for (i = 0; i < cores; i++)
+		core_job[i] = -1;
+	for (i = 0; i < active_jobs; i++)
+	{
+		job_index[jobs[i].job_id] = i;
+		if (jobs[i].core_id != -1)
+			core_job[jobs[i].core_id] = jobs[i].job_id;
+	}
+}
+
+/*
+ * Returns the index in jobs[] of job_id, -1 if no such job is active.
+ */
+int find_job(scheduler_id_t job_id)
+{
+	return (job_id >= 0 && job_id < num_job_ids) ? job_index[job_id] : -1;
+}
+
+/*
+ * Cache warm-up cost of running a job on a different core than last time:
+ * the core is busy for that many time units before the job makes progress.
+ * Cores are grouped into sockets of cores_per_socket cores; moving between
+ * sockets costs socket_penalty instead.
+ */
+int migration_penalty = 0, socket_penalty = 0, cores_per_socket = 0;
+long long migrations = 0, migration_ticks = 0;
+
+/*
+ * Dispatch cost: every time a core starts running a job it is busy for
+ * switch_overhead time units (plus preempt_overhead when the dispatch
+ * displaced a job that had not finished) before the job makes progress.
+ */
+int switch_overhead = 0, preempt_overhead = 0;
+long long switches = 0, preemptions = 0, overhead_ticks = 0, useful_ticks = 0;
+
+void charge_switch(scheduler_time_t *core_overhead, int core_id, int preempted)
+{
+	int cost = switch_overhead;
+	if (preempted)
+	{
+		cost += preempt_overhead;
+		preemptions++;
+	}
+
+	switches++;
+	core_overhead[core_id] += cost;
+}
+
+void place_job(simulator_job_list_t *job, int core_id)
+{
+	if (job->last_core != -1 && job->last_core != core_id)
+	{
+		int penalty = migration_penalty;
+		if (cores_per_socket > 0 && job->last_core / cores_per_socket != core_id / cores_per_socket)
+			penalty = socket_penalty;
+
+		migrations++;
+		migration_ticks += penalty;
+		job->warmup += penalty;
+	}
+
+	job->core_id = core_id;
+	job->last_core = core_id;
+	core_job[core_id] = job->job_id;
+}
+
+void vacate_core(simulator_job_list_t *job)
+{
+	core_job[job->core_id] = -1;
+	job->core_id = -1;
+}
+
+/*
+ * Gives core_id to jobs[index], displacing the job running there (which the
+ * scheduler has queued again).
+ */
+void take_core(simulator_job_list_t *jobs, int index, int core_id, scheduler_time_t *core_overhead)
+{
+	int preempted = 0;
+
+	if (core_job[core_id] != -1)
+	{
+		vacate_core(&jobs[job_index[core_job[core_id]]]);
+		preempted = 1;
+	}
+	charge_switch(core_overhead, core_id, preempted);
+	place_job(&jobs[index], core_id);
+}
+
+/*
+ * Parses the run time column: a single CPU burst, or alternating CPU and
+ * I/O bursts separated by spaces (e.g. "4 10 3"), starting and ending with
+ * a CPU burst.  Returns the number of bursts, 0 if the column is malformed.
+ */
+int parse_bursts(const char *spec, scheduler_time_t **bursts_out)
+{
+	scheduler_time_t *bursts = NULL;
+	int count = 0, capacity = 0;
+	char *end;
+
+	while (1)
+	{
+		long long burst = strtoll(spec, &end, 10);
+		if (end == spec)
+			break;
+		if (burst <= 0)
+		{
+			free(bursts);
+			return 0;
+		}
+		if (count == capacity)
+		{
+			capacity = (capacity == 0) ? 4 : capacity * 2;
+			bursts = realloc(bursts, capacity * sizeof(scheduler_time_t));
+		}
+		bursts[count++] = burst;
+		spec = end;
+	}
+
+	if (count % 2 == 0)
+	{
+		free(bursts);
+		return 0;
+	}
+	*bursts_out = bursts;
+	return count;
+}
+
 void print_usage(char *program_name)
 {
-	fprintf(stderr, "Usage: %s -c <cores> -s <scheme> <input file>\n", program_name);
+	fprintf(stderr, "Usage: %s -c <cores> -s <scheme> [-S] [-q] [-a <window>] [-A <interval>] [-Q <latency>] [-C <speeds> [-b]] [-l <depth>[,<policy>]] [-n <nodes> [-d <dispatch>] [-w <threads>]] [-x <microseconds>] [-L <log file>] [-K <time>,<file>] [-R <file>] [-m <ticks>[,<socket ticks>,<cores per socket>]] [-o <ticks>[,<preemption ticks>]] [-i] [-P] [-p] [-t <ticks>] [-e <events>] <input file>\n", program_name);
 	fprintf(stderr, "       %s -c 2 -s fcfs examples/proc1.csv\n", program_name);
 	fprintf(stderr, "\n");
-	fprintf(stderr, "Acceptable schemes are: fcfs, sjf, psjf, pri, ppri, rr#\n");
+	fprintf(stderr, "Acceptable schemes are: fcfs, sjf, psjf, pri, ppri, rr#, cfs[#], edf, pedf, stride[#]\n");
+	fprintf(stderr, "  (the number after cfs is the target latency, default 8)\n");
+	fprintf(stderr, "  (the number after stride is the quantum, default 1)\n");
+	fprintf(stderr, "  or the path of a shared object ending in .so that defines a scheduler_policy\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "  -S  print the CPU share each priority class received under contention\n");
+	fprintf(stderr, "  -q  give every core its own run queue, with work stealing when idle\n");
+	fprintf(stderr, "  -a  prefer jobs that last ran on the core among the first <window> queued jobs\n");
+	fprintf(stderr, "  -A  under pri and ppri, improve a waiting job's priority by one every <interval>\n");
+	fprintf(stderr, "      time units it waits\n");
+	fprintf(stderr, "  -Q  under rr#, pick each quantum from the number of runnable jobs and recent\n");
+	fprintf(stderr, "      job lengths to aim at <latency>, with # as the smallest quantum\n");
+	fprintf(stderr, "  -C  comma separated speed of each core relative to a nominal core, e.g. 2,2,1,0.5\n");
+	fprintf(stderr, "  -b  with -C, do not tell the scheduler the core speeds (speed-oblivious baseline)\n");
+	fprintf(stderr, "  -l  admit at most <depth> waiting jobs; when full, shed by <policy>: reject\n");
+	fprintf(stderr, "      (turn the arrival away, the default), lowest (drop the lowest priority\n");
+	fprintf(stderr, "      job) or oldest (drop the earliest arrival)\n");
+	fprintf(stderr, "  -n  simulate a cluster of <nodes> nodes of <cores> cores each, reporting only\n");
+	fprintf(stderr, "      the latency distributions (the options below -C do not apply)\n");
+	fprintf(stderr, "  -d  how the cluster routes arrivals to nodes: rr, least or p2c (default rr)\n");
+	fprintf(stderr, "  -w  worker threads simulating the cluster nodes (default: one per CPU)\n");
+	fprintf(stderr, "  -x  run the jobs for real on <cores> threads pinned to CPUs, a time unit\n");
+	fprintf(stderr, "      lasting <microseconds>, and compare the latencies with the simulation\n");
+	fprintf(stderr, "  -L  write every scheduler call and its result to <log file>, for replay\n");
+	fprintf(stderr, "  -K  write the state of the simulation at the start of time unit <time> to <file>\n");
+	fprintf(stderr, "  -R  resume from a checkpoint written by -K with the same trace and cores; the\n");
+	fprintf(stderr, "      scheme and the cost options may differ, for what-if runs\n");
+	fprintf(stderr, "  -m  time units of warm-up when a job resumes on another core, optionally\n");
+	fprintf(stderr, "      a higher cost for crossing sockets of <cores per socket> cores\n");
+	fprintf(stderr, "  -o  time units of overhead for every dispatch, optionally extra time\n");
+	fprintf(stderr, "      units when the dispatch preempts a job\n");
+	fprintf(stderr, "  -i  print the scheduler's internal counters (needs a make STATS=1 build)\n");
+	fprintf(stderr, "  -P, --profile\n");
+	fprintf(stderr, "      print the time spent in each phase of the simulation and in each\n");
+	fprintf(stderr, "      scheduler call\n");
+	fprintf(stderr, "  -p  print latency percentiles, overall and per priority class\n");
+	fprintf(stderr, "  -t  print a snapshot line every <ticks> time units\n");
+	fprintf(stderr, "  -e  print a snapshot line every <events> scheduler calls\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "The input file may have an optional fourth column with each job's\n");
+	fprintf(stderr, "deadline, relative to its arrival time. The run time may be a list of\n");
+	fprintf(stderr, "alternating CPU and I/O bursts separated by spaces, e.g. \"4 10 3\".\n");
+}
+
+/*
+ * Heterogeneous cores: core i retires cpu_speed[i] / SCHEDULER_SPEED_UNIT
+ * units of running time per time unit, carrying the fraction over in
+ * cpu_credit[i].  NULL when every core runs at the nominal speed.
+ */
+int *cpu_speed = NULL, *cpu_credit = NULL;
+long long *cpu_busy_ticks = NULL;
+
+/*
+ * Parses a comma separated list of core speeds relative to a nominal core
+ * (e.g. "2,2,1,0.5"); cores without a speed in the list run at 1.
+ */
+int parse_core_speeds(const char *spec, int cores)
+{
+	int i = 0;
+	char *end;
+
+	cpu_speed = malloc(cores * sizeof(int));
+	cpu_credit = calloc(cores, sizeof(int));
+	cpu_busy_ticks = calloc(cores, sizeof(long long));
+	for (i = 0; i < cores; i++)
+		cpu_speed[i] = SCHEDULER_SPEED_UNIT;
+
+	for (i = 0; *spec != '\0'; i++)
+	{
+		double speed = strtod(spec, &end);
+		if (end == spec || speed <= 0 || i >= cores || (*end != ',' && *end != '\0'))
+			return 0;
+		cpu_speed[i] = (int)(speed * SCHEDULER_SPEED_UNIT + 0.5);
+		if (cpu_speed[i] <= 0)
+			return 0;
+		spec = (*end == ',') ? end + 1 : end;
+	}
+	return 1;
 }
 
-int set_active_job(int job_id, int core_id, simulator_job_list_t *jobs, int active_jobs)
+/*
+ * Target latency of the adaptive RR quantum, 0 for a fixed quantum.
+ */
+int adaptive_latency = 0;
+
+/*
+ * Where every scheduler decision is recorded for replay, NULL when off.
+ */
+decision_log_t *decision_log = NULL;
+
+/*
+ * Phases of the tick loop in main(), for --profile.
+ */
+typedef enum
 {
+	PHASE_FINISH,        // 1. finished jobs and I/O blocks
+	PHASE_QUANTUM,       // 2. quantum expiries
+	PHASE_ARRIVALS,      // 3. I/O completions, arrivals and shedding
+	PHASE_RUN,           // 4. running the time unit
+	PHASE_PRINT,         // 5. the timing diagram and queue
+	PHASE_SANITY,        // 6. the idle check, snapshots and checkpoints
+	NUM_PHASES
+} phase_t;
+
+#define NUM_CALLS (LOG_CORE_STALLED + 1)
+
+/*
+ * With --profile, the cycles spent in each phase of the tick loop and in
+ * each scheduler call, the calls indexed like the decision log's.  Every
+ * cycle of the loop belongs to the phase entered last.  NULL when off.
+ */
+typedef struct _profile_t
+{
+	phase_t phase;
+	unsigned long long mark;                   // when phase was entered
+	unsigned long long phase_cycles[NUM_PHASES];
+	long long phase_calls[NUM_PHASES];         // scheduler calls made in the phase
+	unsigned long long call_cycles[NUM_CALLS];
+	long long calls[NUM_CALLS];
+	long long ticks;
+	unsigned long long start_cycles, stop_cycles;
+	struct timespec start, stop;
+} profile_t;
+
+profile_t *profile = NULL;
+
+void enter_phase(phase_t phase)
+{
+	if (profile == NULL)
+		return;
+
+	unsigned long long now = read_cycles();
+	profile->phase_cycles[profile->phase] += now - profile->mark;
+	profile->phase = phase;
+	profile->mark = now;
+}
+
+/*
+ * Returns when a scheduler call starts, for end_call().
+ */
+unsigned long long start_call()
+{
+	return (profile != NULL) ? read_cycles() : 0;
+}
+
+void end_call(log_call_t call, unsigned long long start)
+{
+	if (profile == NULL)
+		return;
+
+	profile->call_cycles[call] += read_cycles() - start;
+	profile->calls[call]++;
+	profile->phase_calls[profile->phase]++;
+}
+
+void start_profile(profile_t *loop_profile)
+{
+	memset(loop_profile, 0, sizeof(profile_t));
+	profile = loop_profile;
+	profile->phase = PHASE_SANITY;
+	clock_gettime(CLOCK_MONOTONIC, &profile->start);
+	profile->start_cycles = profile->mark = read_cycles();
+}
+
+void stop_profile()
+{
+	enter_phase(profile->phase);
+	profile->stop_cycles = profile->mark;
+	clock_gettime(CLOCK_MONOTONIC, &profile->stop);
+}
+
+/*
+ * Prints where the tick loop spent its time.  The cycle counter is converted
+ * to nanoseconds by its rate over the whole loop.
+ */
+void print_profile()
+{
+	const char *phase_names[NUM_PHASES] = { "finish check", "quantum check", "arrivals", "run", "print", "sanity check" };
+	const char *call_names[NUM_CALLS] = { "", "scheduler_new_jobs", "scheduler_job_finished", "scheduler_job_blocked",
+		"scheduler_job_unblocked", "scheduler_quantum_expired", "scheduler_time_slice", "scheduler_shed_job",
+		"scheduler_core_stalled" };
+	long long events = 0;
 	int i;
+
+	unsigned long long cycles = profile->stop_cycles - profile->start_cycles;
+	double total_ns = (profile->stop.tv_sec - profile->start.tv_sec) * 1e9 + (profile->stop.tv_nsec - profile->start.tv_nsec);
+	double ns_per_cycle = (cycles > 0) ? total_ns / cycles : 0.0;
+
+	for (i = 1; i < NUM_CALLS; i++)
+		events += profile->calls[i];
+
+	printf("\nProfile of the tick loop: %.3f ms, %lld ticks, %lld scheduler calls\n", total_ns / 1e6, profile->ticks, events);
+	printf("  %.1f ns per tick, %.1f ns per scheduler call\n",
+			profile->ticks > 0 ? total_ns / profile->ticks : 0.0, events > 0 ? total_ns / events : 0.0);
+	printf("  %-26s %12s %7s %12s %10s\n", "Phase", "ms", "%", "ns/tick", "calls");
+	for (i = 0; i < NUM_PHASES; i++)
+	{
+		double ns = profile->phase_cycles[i] * ns_per_cycle;
+		printf("  %-26s %12.3f %6.2f%% %12.1f %10lld\n", phase_names[i], ns / 1e6, total_ns > 0 ? 100.0 * ns / total_ns : 0.0,
+				profile->ticks > 0 ? ns / profile->ticks : 0.0, profile->phase_calls[i]);
+	}
+	printf("  %-26s %12s %7s %12s %10s\n", "Scheduler call", "ms", "%", "ns/call", "calls");
+	for (i = 1; i < NUM_CALLS; i++)
+	{
+		if (profile->calls[i] == 0)
+			continue;
+		double ns = profile->call_cycles[i] * ns_per_cycle;
+		printf("  %-26s %12.3f %6.2f%% %12.1f %10lld\n", call_names[i], ns / 1e6, total_ns > 0 ? 100.0 * ns / total_ns : 0.0,
+				ns / profile->calls[i], profile->calls[i]);
+	}
+}
+
+/*
+ * The quantum a newly dispatched job on core_id should run for.  RR uses the
+ * fixed quantum from the command line, CFS and adaptive RR ask the scheduler.
+ */
+scheduler_time_t next_quantum(int scheme, int quantum, int core_id)
+{
+	if (scheme == CFS || (scheme == RR && adaptive_latency > 0))
+	{
+		unsigned long long start = start_call();
+		scheduler_time_t slice = scheduler_time_slice(core_id);
+		end_call(LOG_TIME_SLICE, start);
+		if (decision_log != NULL)
+			decision_log_call(decision_log, LOG_TIME_SLICE, core_id, 0, 0, slice);
+		return slice;
+	}
+
+	return quantum;
+}
+
+/*
+ * Tells the scheduler that the job on core_id held it for the time unit
+ * without running, so that it is not charged to the job's remaining time.
+ */
+void stall_core(int core_id)
+{
+	unsigned long long start = start_call();
+	scheduler_core_stalled(core_id, 1);
+	end_call(LOG_CORE_STALLED, start);
+	if (decision_log != NULL)
+		decision_log_call(decision_log, LOG_CORE_STALLED, core_id, 1, 0, 0);
+}
+
+/*
+ * Takes a job that finished or was shed out of the active jobs.
+ */
+int remove_job(scheduler_id_t job_id, simulator_job_list_t *jobs, int active_jobs)
+{
+	int i = find_job(job_id);
+
+	if (i == -1)
+		return active_jobs;
+
+	if (jobs[i].core_id != -1)
+		vacate_core(&jobs[i]);
+	free(jobs[i].bursts);
+	job_index[job_id] = -1;
+	if (i != active_jobs - 1)
+	{
+		memcpy(&jobs[i], &jobs[active_jobs - 1], sizeof(simulator_job_list_t));
+		job_index[jobs[i].job_id] = i;
+	}
+	return active_jobs - 1;
+}
+
+int set_active_job(scheduler_id_t job_id, int core_id, simulator_job_list_t *jobs)
+{
+	int i = find_job(job_id);
+
+	if (i == -1 || !jobs[i].arrived)
+		return 0;
+
+	place_job(&jobs[i], core_id);
+	return 1;
+}
+
+void print_available_jobs(simulator_job_list_t *jobs, int active_jobs)
+{
+	printf("Active jobs are: ");
+
+	int i, first = 1;
 	for (i = 0; i < active_jobs; i++)
 	{
-		if (jobs[i].job_id == job_id && jobs[i].arrived)
+		if (jobs[i].arrived)
 		{
-			jobs[i].core_id = core_id;
-			return 1;
+			if (first)
+			{
+				printf("%lld", jobs[i].job_id);
+				first = 0;
+			}
+			else
+				printf(", %lld", jobs[i].job_id);
 		}
 	}
 
-	return 0;
+	if (!first)
+		printf("\n");
+}
+
+void print_available_cores(int cores)
+{
+	printf("Active cores are: ");
+
+	int i;
+	for (i = 0; i < cores; i++)
+	{
+		if (i == cores - 1)
+			printf("%d\n", i);
+		else
+			printf("%d, ", i);
+	}
+}
+
+
+void print_percentile_row(const char *label, metric_t metric, int all, int priority)
+{
+	const double percentiles[] = { 50, 90, 99, 99.9, 100 };
+	int i;
+
+	printf("  %-12s", label);
+	for (i = 0; i < 5; i++)
+	{
+		long long value = all ? scheduler_latency_percentile(metric, percentiles[i])
+		                      : scheduler_class_latency_percentile(metric, priority, percentiles[i]);
+		printf(" %8lld", value);
+	}
+	printf("\n");
 }
 
-void print_available_jobs(simulator_job_list_t *jobs, int active_jobs)
-{
-	printf("Active jobs are: ");
+void print_percentiles(int min_priority, int max_priority, int has_bursts)
+{
+	const char *metric_names[NUM_METRICS] = { "Waiting", "Turnaround", "Response", "I/O response" };
+	char label[32];
+	int m, p;
+
+	for (m = 0; m < NUM_METRICS; m++)
+	{
+		if (m == METRIC_IO_RESPONSE && !has_bursts)
+			continue;
+		printf("\n%s time percentiles:\n", metric_names[m]);
+		printf("  %-12s %8s %8s %8s %8s %8s\n", "", "p50", "p90", "p99", "p99.9", "max");
+		print_percentile_row("All", m, 1, 0);
+		for (p = min_priority; p <= max_priority; p++)
+		{
+			if (scheduler_class_jobs(p) == 0)
+				continue;
+			snprintf(label, sizeof(label), "Priority %d", p);
+			print_percentile_row(label, m, 0, p);
+		}
+	}
+}
+
+void print_snapshot(scheduler_time_t time)
+{
+	scheduler_snapshot_t snapshot;
+	scheduler_snapshot(time, &snapshot);
+
+	printf("[SNAPSHOT %lld] finished=%lld shed=%lld in-flight=%lld queue=%lld busy-cores=%d throughput=%.3f wait(avg/p50/p99)=%.2f/%lld/%lld turnaround=%.2f response=%.2f\n",
+			snapshot.time, snapshot.finished_jobs, snapshot.shed_jobs, snapshot.in_flight_jobs, snapshot.queue_depth, snapshot.busy_cores, snapshot.throughput,
+			snapshot.mean_waiting_time, snapshot.p50_waiting_time, snapshot.p99_waiting_time,
+			snapshot.mean_turnaround_time, snapshot.mean_response_time);
+}
+
+/*
+ * Counts a scheduler call, printing a snapshot every snapshot_events calls.
+ */
+void count_event(scheduler_time_t time, int *events, int snapshot_events)
+{
+	(*events)++;
+	if (snapshot_events > 0 && *events % snapshot_events == 0)
+		print_snapshot(time);
+}
+
+void print_scheduler_stats()
+{
+	const char *entry_names[NUM_ENTRIES] = { "scheduler_new_job", "scheduler_new_jobs", "scheduler_job_finished", "scheduler_job_blocked",
+		"scheduler_job_unblocked", "scheduler_quantum_expired", "scheduler_time_slice" };
+	scheduler_stats_t stats;
+	int i;
+
+	printf("\nScheduler statistics:\n");
+	scheduler_policy_stats(stdout);
+	if (!scheduler_stats_enabled())
+	{
+		printf("  (compiled out, rebuild with make STATS=1)\n");
+		return;
+	}
+
+	scheduler_get_stats(&stats);
+	printf("  Comparisons: %llu\n", stats.comparisons);
+	printf("  Queue offers / polls: %llu / %llu\n", stats.offers, stats.polls);
+	printf("  Preemptions: %llu\n", stats.preemptions);
+	printf("  Quantum expiries requeued / continued: %llu / %llu\n", stats.quantum_requeues, stats.quantum_continues);
+	printf("  Queue depth max / mean: %lld / %.2f\n", stats.max_queue_depth, stats.mean_queue_depth);
+	for (i = 0; i < NUM_ENTRIES; i++)
+		if (stats.calls[i] > 0)
+			printf("  %-26s %8llu calls, %10.1f cycles/call\n", entry_names[i], stats.calls[i], (double)stats.cycles[i] / stats.calls[i]);
+}
+
+/*
+ * The state of the tick loop in main(), for checkpoints.  The fields point
+ * at main()'s variables.
+ */
+typedef struct _loop_state_t
+{
+	scheduler_time_t *time;
+	int *events;
+	simulator_job_list_t *jobs;
+	int *active_jobs, *jobs_alive, *jobs_blocked;
+	long long *busy_core_ticks;
+	calqueue_t *future_events;
+	scheduler_time_t *quantum_clock, *core_overhead;
+	char **core_timing_diagram;
+	int *core_timing_diagram_size;
+} loop_state_t;
+
+#define CHECKPOINT_MAGIC 0x32504b53 // "SKP2"
+
+/*
+ * Identifies the trace a checkpoint was taken from (FNV-1a over every
+ * job's columns), so that it is only resumed with the same jobs.
+ */
+unsigned int hash_trace(simulator_job_list_t *jobs, scheduler_id_t count)
+{
+	unsigned int hash = 2166136261u;
+	scheduler_id_t i;
+	int j;
+
+	for (i = 0; i < count; i++)
+	{
+		long long fields[3] = { jobs[i].arrival_time, jobs[i].priority, jobs[i].deadline };
+		for (j = 0; j < 3 + jobs[i].burst_count; j++)
+		{
+			unsigned long long value = (j < 3) ? fields[j] : jobs[i].bursts[j - 3];
+			hash = (hash ^ (unsigned int)value) * 16777619u;
+			hash = (hash ^ (unsigned int)(value >> 32)) * 16777619u;
+		}
+	}
+
+	return hash;
+}
+
+int write_value(FILE *file, const void *value, size_t size)
+{
+	return size == 0 || fwrite(value, size, 1, file) == 1;
+}
+
+int read_value(FILE *file, void *value, size_t size)
+{
+	return size == 0 || fread(value, size, 1, file) == 1;
+}
+
+/*
+ * Writes the simulation at the start of a time unit to path, the loop
+ * state followed by the scheduler's (see scheduler_checkpoint()).  scheme
+ * is the -s argument, so that a run resumed under another scheme knows to
+ * restart the quantum clocks.
+ */
+int save_checkpoint(const char *path, loop_state_t *state, int cores, unsigned int trace, const char *scheme)
+{
+	FILE *file = fopen(path, "wb");
+	if (file == NULL)
+		return 0;
+
+	int magic = CHECKPOINT_MAGIC, speeds = (cpu_speed != NULL), length = strlen(scheme);
+	int ok = write_value(file, &magic, sizeof(int)) && write_value(file, &cores, sizeof(int)) &&
+			write_value(file, &trace, sizeof(unsigned int)) && write_value(file, &speeds, sizeof(int)) &&
+			write_value(file, &length, sizeof(int)) && write_value(file, scheme, length);
+
+	ok = ok && write_value(file, state->time, sizeof(scheduler_time_t)) && write_value(file, state->events, sizeof(int)) &&
+			write_value(file, state->active_jobs, sizeof(int)) && write_value(file, state->jobs_alive, sizeof(int)) &&
+			write_value(file, state->jobs_blocked, sizeof(int)) && write_value(file, state->busy_core_ticks, sizeof(long long));
+
+	long long counters[6] = { migrations, migration_ticks, switches, preemptions, overhead_ticks, useful_ticks };
+	ok = ok && write_value(file, counters, sizeof(counters));
+	if (speeds)
+		ok = ok && write_value(file, cpu_credit, cores * sizeof(int)) && write_value(file, cpu_busy_ticks, cores * sizeof(long long));
+
+	int i;
+	for (i = 0; ok && i < *state->active_jobs; i++)
+		ok = write_value(file, &state->jobs[i], sizeof(simulator_job_list_t)) &&
+				write_value(file, state->jobs[i].bursts, state->jobs[i].burst_count * sizeof(scheduler_time_t));
+
+	// Arrivals are rebuilt from the jobs on restore, only I/O completions are kept
+	int pending = 0, queued = calqueue_size(state->future_events);
+	event_t **future = malloc(queued * sizeof(event_t *));
+	calqueue_to_array(state->future_events, (void **)future);
+	for (i = 0; i < queued; i++)
+		if (future[i]->kind == EVENT_IO_DONE)
+			future[pending++] = future[i];
+	ok = ok && write_value(file, &pending, sizeof(int));
+	for (i = 0; ok && i < pending; i++)
+		ok = write_value(file, &future[i]->time, sizeof(scheduler_time_t)) && write_value(file, &future[i]->job_id, sizeof(scheduler_id_t));
+	free(future);
+
+	ok = ok && write_value(file, state->quantum_clock, cores * sizeof(scheduler_time_t)) && write_value(file, state->core_overhead, cores * sizeof(scheduler_time_t));
+	for (i = 0; ok && i < cores; i++)
+	{
+		length = strlen(state->core_timing_diagram[i]);
+		ok = write_value(file, &length, sizeof(int)) && write_value(file, state->core_timing_diagram[i], length);
+	}
+
+	ok = ok && scheduler_checkpoint(file) == 0;
+	return fclose(file) == 0 && ok;
+}
+
+/*
+ * Resumes from a checkpoint written by save_checkpoint() for the same
+ * trace and number of cores.  The scheduler must be set up and the jobs
+ * read from the trace; they are replaced by the checkpoint's.  Sets
+ * *same_scheme to whether the checkpoint was taken under scheme.
+ */
+int load_checkpoint(const char *path, loop_state_t *state, int cores, unsigned int trace, const char *scheme, int *same_scheme)
+{
+	FILE *file = fopen(path, "rb");
+	if (file == NULL)
+		return 0;
+
+	int magic, saved_cores, speeds, length, i;
+	unsigned int saved_trace;
+	char saved_scheme[256];
+	int ok = read_value(file, &magic, sizeof(int)) && magic == CHECKPOINT_MAGIC &&
+			read_value(file, &saved_cores, sizeof(int)) && saved_cores == cores &&
+			read_value(file, &saved_trace, sizeof(unsigned int)) && saved_trace == trace &&
+			read_value(file, &speeds, sizeof(int)) && speeds == (cpu_speed != NULL) &&
+			read_value(file, &length, sizeof(int)) && length >= 0 && length < (int)sizeof(saved_scheme) &&
+			read_value(file, saved_scheme, length);
+
+	if (ok)
+	{
+		saved_scheme[length] = '\0';
+		*same_scheme = (strcasecmp(saved_scheme, scheme) == 0);
+	}
+
+	for (i = 0; i < *state->active_jobs; i++)
+		free(state->jobs[i].bursts);
+	int total = *state->active_jobs;
+	*state->active_jobs = 0;
+
+	int active_jobs;
+	ok = ok && read_value(file, state->time, sizeof(scheduler_time_t)) && read_value(file, state->events, sizeof(int)) &&
+			read_value(file, &active_jobs, sizeof(int)) && active_jobs >= 0 && active_jobs <= total &&
+			read_value(file, state->jobs_alive, sizeof(int)) && read_value(file, state->jobs_blocked, sizeof(int)) &&
+			read_value(file, state->busy_core_ticks, sizeof(long long));
+
+	long long counters[6];
+	ok = ok && read_value(file, counters, sizeof(counters));
+	if (ok)
+	{
+		migrations = counters[0];
+		migration_ticks = counters[1];
+		switches = counters[2];
+		preemptions = counters[3];
+		overhead_ticks = counters[4];
+		useful_ticks = counters[5];
+	}
+	if (speeds)
+		ok = ok && read_value(file, cpu_credit, cores * sizeof(int)) && read_value(file, cpu_busy_ticks, cores * sizeof(long long));
+
+	for (i = 0; ok && i < active_jobs; i++)
+	{
+		simulator_job_list_t *job = &state->jobs[i];
+		ok = read_value(file, job, sizeof(simulator_job_list_t)) && job->burst_count > 0 &&
+				job->job_id >= 0 && job->job_id < num_job_ids && job->core_id >= -1 && job->core_id < cores;
+		job->bursts = ok ? malloc(job->burst_count * sizeof(scheduler_time_t)) : NULL;
+		ok = ok && read_value(file, job->bursts, job->burst_count * sizeof(scheduler_time_t));
+		*state->active_jobs = i + 1;
+	}
+
+	int pending;
+	ok = ok && read_value(file, &pending, sizeof(int)) && pending >= 0;
+	for (i = 0; ok && i < pending; i++)
+	{
+		scheduler_time_t when;
+		scheduler_id_t job_id;
+		ok = read_value(file, &when, sizeof(scheduler_time_t)) && read_value(file, &job_id, sizeof(scheduler_id_t)) &&
+				when >= 0 && job_id >= 0 && job_id < num_job_ids;
+		if (ok)
+			push_event(state->future_events, when, job_id, EVENT_IO_DONE);
+	}
+
+	ok = ok && read_value(file, state->quantum_clock, cores * sizeof(scheduler_time_t)) && read_value(file, state->core_overhead, cores * sizeof(scheduler_time_t));
+	for (i = 0; ok && i < cores; i++)
+	{
+		ok = read_value(file, &length, sizeof(int)) && length >= 0;
+		if (!ok)
+			break;
+
+		if (length >= *state->core_timing_diagram_size)
+		{
+			int j;
+			while (length >= *state->core_timing_diagram_size)
+				*state->core_timing_diagram_size *= 2;
+			for (j = 0; j < cores; j++)
+				state->core_timing_diagram[j] = realloc(state->core_timing_diagram[j], *state->core_timing_diagram_size + 1);
+		}
+		ok = read_value(file, state->core_timing_diagram[i], length);
+		state->core_timing_diagram[i][ok ? length : 0] = '\0';
+	}
+
+	ok = ok && scheduler_restore(file) == 0;
+	fclose(file);
+	return ok;
+}
+
+
+int main(int argc, char **argv)
+{
+	int c;
+	int cores = 0, scheme = -1, quantum = 0, latency = 8;
+	const scheduler_policy_ops *policy = NULL;
+	char *policy_file = NULL;
+	char *speed_spec = NULL;
+	int nodes = 0, threads = 0, tick_us = 0;
+	int queue_limit = -1;
+	admission_t admission = ADMIT_REJECT_NEW;
+	dispatch_t dispatch = DISPATCH_RR;
+	int speed_oblivious = 0;
+	int show_shares = 0, per_core_queues = 0, affinity_window = 0, aging_interval = 0, model_migrations = 0, model_overhead = 0, show_stats = 0, show_percentiles = 0, show_profile = 0;
+	int snapshot_ticks = 0, snapshot_events = 0, events = 0;
+	char *file_name;
+	char *log_file = NULL;
+	char *scheme_name = NULL, *checkpoint_file = NULL, *restore_file = NULL;
+	scheduler_time_t checkpoint_time = -1;
+
+	/*
+	 * Parse command line options.
+	 */
+	const struct option long_options[] = { { "profile", no_argument, NULL, 'P' }, { NULL, 0, NULL, 0 } };
+	while ((c = getopt_long(argc, argv, "c:s:Sqa:A:Q:C:bl:n:d:w:x:L:K:R:m:o:iPpt:e:", long_options, NULL)) != -1)
+	{
+		switch (c)
+		{
+			case 'c':
+				cores = atoi(optarg);
+
+				if (cores <= 0)
+				{
+					fprintf(stderr, "Option -c <cores> require a positive number.\n");
+					print_usage(argv[0]);
+					return 1;
+				}
+				break;
+
+			case 's':
+				scheme_name = optarg;
+				if (strcasecmp(optarg, "FCFS") == 0) { scheme = FCFS; }
+				else if (strcasecmp(optarg, "SJF") == 0) { scheme = SJF; }
+				else if (strcasecmp(optarg, "PSJF") == 0) { scheme = PSJF; }
+				else if (strcasecmp(optarg, "PRI") == 0) { scheme = PRI; }
+				else if (strcasecmp(optarg, "PPRI") == 0) { scheme = PPRI; }
+				else if (strcasecmp(optarg, "EDF") == 0) { scheme = EDF; }
+				else if (strcasecmp(optarg, "PEDF") == 0) { scheme = PEDF; }
+				else if (strncasecmp(optarg, "RR", 2) == 0)
+				{
+					scheme = RR;
+					quantum = atoi(optarg + 2);
+
+					if (quantum <= 0)
+					{
+						fprintf(stderr, "Option -s <scheme> requires a positive number for the quantum of RR. (Eg: -s RR2)\n");
+						print_usage(argv[0]);
+						return 1;
+					}
+				}
+				else if (strncasecmp(optarg, "CFS", 3) == 0)
+				{
+					scheme = CFS;
+
+					if (optarg[3] != '\0')
+					{
+						latency = atoi(optarg + 3);
+
+						if (latency <= 0)
+						{
+							fprintf(stderr, "Option -s <scheme> requires a positive target latency for CFS. (Eg: -s CFS8)\n");
+							print_usage(argv[0]);
+							return 1;
+						}
+					}
+				}
+				else if (strlen(optarg) > 3 && strcmp(optarg + strlen(optarg) - 3, ".so") == 0)
+				{
+					policy_file = optarg;
+					policy = scheduler_load_policy(policy_file);
+
+					if (policy == NULL)
+					{
+						fprintf(stderr, "Unable to load a scheduling policy from \"%s\".\n", policy_file);
+						return 1;
+					}
+					quantum = policy->quantum;
+				}
+				else if (strncasecmp(optarg, "STRIDE", 6) == 0)
+				{
+					scheme = STRIDE;
+					quantum = 1;
+
+					if (optarg[6] != '\0')
+					{
+						quantum = atoi(optarg + 6);
+
+						if (quantum <= 0)
+						{
+							fprintf(stderr, "Option -s <scheme> requires a positive quantum for STRIDE. (Eg: -s STRIDE2)\n");
+							print_usage(argv[0]);
+							return 1;
+						}
+					}
+				}
+				break;
+
+			case 'S':
+				show_shares = 1;
+				break;
+
+			case 'q':
+				per_core_queues = 1;
+				break;
+
+			case 'a':
+				affinity_window = atoi(optarg);
+
+				if (affinity_window <= 0)
+				{
+					fprintf(stderr, "Option -a <window> requires a positive number.\n");
+					print_usage(argv[0]);
+					return 1;
+				}
+				break;
+
+			case 'A':
+				aging_interval = atoi(optarg);
+
+				if (aging_interval <= 0)
+				{
+					fprintf(stderr, "Option -A <interval> requires a positive number.\n");
+					print_usage(argv[0]);
+					return 1;
+				}
+				break;
+
+			case 'Q':
+				adaptive_latency = atoi(optarg);
+
+				if (adaptive_latency <= 0)
+				{
+					fprintf(stderr, "Option -Q <latency> requires a positive number.\n");
+					print_usage(argv[0]);
+					return 1;
+				}
+				break;
+
+			case 'C':
+				speed_spec = optarg;
+				break;
+
+			case 'b':
+				speed_oblivious = 1;
+				break;
+
+			case 'l':
+			{
+				char *policy_name = strchr(optarg, ',');
+
+				queue_limit = (*optarg >= '0' && *optarg <= '9') ? atoi(optarg) : -1;
+				if (policy_name == NULL || strcasecmp(policy_name + 1, "reject") == 0) { admission = ADMIT_REJECT_NEW; }
+				else if (strcasecmp(policy_name + 1, "lowest") == 0) { admission = ADMIT_DROP_LOWEST; }
+				else if (strcasecmp(policy_name + 1, "oldest") == 0) { admission = ADMIT_DROP_OLDEST; }
+				else { queue_limit = -1; }
+
+				if (queue_limit < 0)
+				{
+					fprintf(stderr, "Option -l requires <depth> or <depth>,reject|lowest|oldest. (Eg: -l 4,lowest)\n");
+					print_usage(argv[0]);
+					return 1;
+				}
+				break;
+			}
+
+			case 'n':
+				nodes = atoi(optarg);
+
+				if (nodes <= 0)
+				{
+					fprintf(stderr, "Option -n <nodes> requires a positive number.\n");
+					print_usage(argv[0]);
+					return 1;
+				}
+				break;
+
+			case 'd':
+				if (strcasecmp(optarg, "rr") == 0) { dispatch = DISPATCH_RR; }
+				else if (strcasecmp(optarg, "least") == 0) { dispatch = DISPATCH_LEAST; }
+				else if (strcasecmp(optarg, "p2c") == 0) { dispatch = DISPATCH_P2C; }
+				else
+				{
+					fprintf(stderr, "Option -d <dispatch> must be rr, least or p2c.\n");
+					print_usage(argv[0]);
+					return 1;
+				}
+				break;
+
+			case 'w':
+				threads = atoi(optarg);
+
+				if (threads <= 0)
+				{
+					fprintf(stderr, "Option -w <threads> requires a positive number.\n");
+					print_usage(argv[0]);
+					return 1;
+				}
+				break;
+
+			case 'x':
+				tick_us = atoi(optarg);
+
+				if (tick_us <= 0)
+				{
+					fprintf(stderr, "Option -x <microseconds> requires a positive number.\n");
+					print_usage(argv[0]);
+					return 1;
+				}
+				break;
+
+			case 'L':
+				log_file = optarg;
+				break;
 
-	int i, first = 1;
-	for (i = 0; i < active_jobs; i++)
-	{
-		if (jobs[i].arrived)
-		{
-			if (first)
+			case 'K':
 			{
-				printf("%d", jobs[i].job_id);
-				first = 0;
+				char *path = strchr(optarg, ',');
+
+				checkpoint_time = (*optarg >= '0' && *optarg <= '9') ? atoll(optarg) : -1;
+				if (path == NULL || path[1] == '\0' || checkpoint_time < 0)
+				{
+					fprintf(stderr, "Option -K requires <time>,<file>. (Eg: -K 100,warm.ckpt)\n");
+					print_usage(argv[0]);
+					return 1;
+				}
+				checkpoint_file = path + 1;
+				break;
 			}
-			else
-				printf(", %d", jobs[i].job_id);
-		}
-	}
 
-	if (!first)
-		printf("\n");
-}
+			case 'R':
+				restore_file = optarg;
+				break;
 
-void print_available_cores(int cores)
-{
-	printf("Active cores are: ");
+			case 'm':
+			{
+				int fields = sscanf(optarg, "%d,%d,%d", &migration_penalty, &socket_penalty, &cores_per_socket);
 
-	int i;
-	for (i = 0; i < cores; i++)
-	{
-		if (i == cores - 1)
-			printf("%d\n", i);
-		else
-			printf("%d, ", i);
-	}
-}
+				if (fields == 1)
+				{
+					socket_penalty = migration_penalty;
+					cores_per_socket = 0;
+				}
 
+				if ((fields != 1 && fields != 3) || migration_penalty < 0 || socket_penalty < 0 || cores_per_socket < 0)
+				{
+					fprintf(stderr, "Option -m requires <ticks> or <ticks>,<socket ticks>,<cores per socket>. (Eg: -m 2,5,4)\n");
+					print_usage(argv[0]);
+					return 1;
+				}
+				model_migrations = 1;
+				break;
+			}
 
-int main(int argc, char **argv)
-{
-	int c;
-	int cores = 0, scheme = -1, quantum = 0;
-	char *file_name;
+			case 'i':
+				show_stats = 1;
+				break;
 
-	/*
-	 * Parse command line options.
-	 */
-	while ((c = getopt(argc, argv, "c:s:")) != -1)
-	{
-		switch (c)
-		{
-			case 'c':
-				cores = atoi(optarg);
+			case 'P':
+				show_profile = 1;
+				break;
 
-				if (cores <= 0)
+			case 'p':
+				show_percentiles = 1;
+				break;
+
+			case 't':
+			case 'e':
+				if (atoi(optarg) <= 0)
 				{
-					fprintf(stderr, "Option -c <cores> require a positive number.\n");
+					fprintf(stderr, "Option -%c requires a positive number.\n", c);
 					print_usage(argv[0]);
 					return 1;
 				}
+
+				if (c == 't')
+					snapshot_ticks = atoi(optarg);
+				else
+					snapshot_events = atoi(optarg);
 				break;
 
-			case 's':
-				if (strcasecmp(optarg, "FCFS") == 0) { scheme = FCFS; }
-				else if (strcasecmp(optarg, "SJF") == 0) { scheme = SJF; }
-				else if (strcasecmp(optarg, "PSJF") == 0) { scheme = PSJF; }
-				else if (strcasecmp(optarg, "PRI") == 0) { scheme = PRI; }
-				else if (strcasecmp(optarg, "PPRI") == 0) { scheme = PPRI; }
-				else if (strncasecmp(optarg, "RR", 2) == 0)
-				{
-					scheme = RR;
-					quantum = atoi(optarg + 2);
+			case 'o':
+			{
+				int fields = sscanf(optarg, "%d,%d", &switch_overhead, &preempt_overhead);
 
-					if (quantum <= 0)
-					{
-						fprintf(stderr, "Option -s <scheme> requires a positive number for the quantum of RR. (Eg: -s RR2)\n");
-						print_usage(argv[0]);
-						return 1;
-					}
+				if (fields < 1 || switch_overhead < 0 || preempt_overhead < 0)
+				{
+					fprintf(stderr, "Option -o requires <ticks> or <ticks>,<preemption ticks>. (Eg: -o 1,1)\n");
+					print_usage(argv[0]);
+					return 1;
 				}
+				model_overhead = 1;
 				break;
+			}
 
 			case '?':
 				print_usage(argv[0]);
@@ -140,13 +1143,27 @@ int main(int argc, char **argv)
 		return 1;
 	}
 
-	if (scheme == -1)
+	if (scheme == -1 && policy == NULL)
 	{
 		fprintf(stderr, "Required option -s <scheme> is not present.\n");
 		print_usage(argv[0]);
 		return 1;
 	}
 
+	if (restore_file != NULL && log_file != NULL)
+	{
+		fprintf(stderr, "Option -L cannot be used with -R, as a log is replayed from the start.\n");
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	if (speed_spec != NULL && !parse_core_speeds(speed_spec, cores))
+	{
+		fprintf(stderr, "Option -C <speeds> requires at most %d positive numbers separated by commas. (Eg: -C 2,1)\n", cores);
+		print_usage(argv[0]);
+		return 1;
+	}
+
 	if (optind == argc - 1)
 		file_name = argv[optind];
 	else
@@ -168,8 +1185,10 @@ int main(int argc, char **argv)
 	}
 
 
-	int job_id = 0;
-	int jobs_ct = 10;
+	scheduler_id_t job_id = 0;
+	scheduler_id_t jobs_ct = 10;
+	int has_deadlines = 0, has_bursts = 0;
+	int min_priority = 0, max_priority = 0;
 	simulator_job_list_t* jobs = malloc(jobs_ct * sizeof(simulator_job_list_t));
 
 	char line[1024 + 1];
@@ -179,6 +1198,7 @@ int main(int argc, char **argv)
 		char *arrival_time = strtok(line, ",");
 		char *run_time = strtok(NULL, ",");
 		char *priority = strtok(NULL, ",");
+		char *deadline = strtok(NULL, ",");
 
 		if (arrival_time != NULL && run_time != NULL && priority != NULL)
 		{
@@ -195,11 +1215,41 @@ int main(int argc, char **argv)
 			}
 
 			jobs[job_id].job_id = job_id;
-			jobs[job_id].arrival_time = atoi(arrival_time);
-			jobs[job_id].run_time = atoi(run_time);
+			jobs[job_id].arrival_time = atoll(arrival_time);
+			jobs[job_id].bursts = NULL;
+			jobs[job_id].burst_count = parse_bursts(run_time, &jobs[job_id].bursts);
+			if (jobs[job_id].burst_count == 0)
+			{
+				fprintf(stderr, "Illegal file format.\n");
+				return 2;
+			}
+			jobs[job_id].run_time = jobs[job_id].bursts[0];
+			jobs[job_id].next_burst = 1;
+			jobs[job_id].blocked = 0;
+			if (jobs[job_id].burst_count > 1)
+				has_bursts = 1;
 			jobs[job_id].priority = atoi(priority);
+			jobs[job_id].deadline = -1;
+
+			if (job_id == 0 || jobs[job_id].priority < min_priority)
+				min_priority = jobs[job_id].priority;
+			if (job_id == 0 || jobs[job_id].priority > max_priority)
+				max_priority = jobs[job_id].priority;
+
+			char *end;
+			if (deadline != NULL)
+			{
+				long long relative = strtoll(deadline, &end, 10);
+				if (end != deadline)
+				{
+					jobs[job_id].deadline = jobs[job_id].arrival_time + relative;
+					has_deadlines = 1;
+				}
+			}
 			jobs[job_id].core_id = -1;
 			jobs[job_id].arrived = 0;
+			jobs[job_id].last_core = -1;
+			jobs[job_id].warmup = 0;
 
 			job_id++;
 		}
@@ -212,73 +1262,267 @@ int main(int argc, char **argv)
 
 	fclose(file);
 
+	if (nodes > 0 || tick_us > 0)
+	{
+		cluster_job_t *cluster_jobs = malloc(job_id * sizeof(cluster_job_t));
+		int i, j, result;
+
+		for (i = 0; i < job_id; i++)
+		{
+			cluster_jobs[i].arrival_time = jobs[i].arrival_time;
+			cluster_jobs[i].run_time = 0;
+			for (j = 0; j < jobs[i].burst_count; j += 2)
+				cluster_jobs[i].run_time += jobs[i].bursts[j];
+			cluster_jobs[i].priority = jobs[i].priority;
+			cluster_jobs[i].deadline = jobs[i].deadline;
+		}
+		if (tick_us > 0)
+		{
+			executor_config_t config = { cores, scheme, policy, quantum, latency, tick_us };
+			result = executor_run(&config, cluster_jobs, job_id);
+		}
+		else
+		{
+			cluster_config_t config = { nodes, cores, threads, scheme, policy, quantum, latency, dispatch, 1 };
+			if (config.threads == 0)
+				config.threads = sysconf(_SC_NPROCESSORS_ONLN);
+			result = cluster_run(&config, cluster_jobs, job_id);
+		}
+		free(cluster_jobs);
+		for (i = 0; i < job_id; i++)
+			free(jobs[i].bursts);
+		free(jobs);
+		return result;
+	}
 
 	/*
 	 * Run the simulation.
 	 */
 
-	printf("Loaded %d core(s) and %d job(s) using ", cores, job_id);
+	printf("Loaded %d core(s) and %lld job(s) using ", cores, job_id);
 	if (scheme == FCFS) { printf("First Come First Served (FCFS)"); }
 	else if (scheme == SJF) { printf("Non-preemptive Shortest Job First (SJF)"); }
 	else if (scheme == PSJF) { printf("Preemptive Shortest Job First (PSJF)"); }
 	else if (scheme == PRI) { printf("Non-preemptive Priority (PRI)"); }
 	else if (scheme == PPRI) { printf("Preemptive Priority (PPRI)"); }
+	else if (scheme == RR && adaptive_latency > 0) { printf("Round Robin (RR) with an adaptive quantum of at least %d for a target latency of %d", quantum, adaptive_latency); }
 	else if (scheme == RR) { printf("Round Robin (RR) with a quantum of %d", quantum); }
+	else if (scheme == CFS) { printf("Completely Fair Scheduler (CFS) with a target latency of %d", latency); }
+	else if (scheme == EDF) { printf("Non-preemptive Earliest Deadline First (EDF)"); }
+	else if (scheme == PEDF) { printf("Preemptive Earliest Deadline First (PEDF)"); }
+	else if (scheme == STRIDE) { printf("Stride Scheduling (STRIDE) with a quantum of %d", quantum); }
+	else if (policy != NULL) { printf("the \"%s\" policy from %s", policy->name, policy_file); }
 	printf(" scheduling...\n\n");
 
-	scheduler_start_up(cores, scheme);
+	if (policy != NULL)
+		scheduler_start_up_policy(cores, policy);
+	else
+		scheduler_start_up(cores, scheme);
+	if (scheme == CFS)
+		scheduler_set_target_latency(latency);
+	if (per_core_queues)
+		scheduler_set_per_core_queues(1);
+	if (affinity_window)
+		scheduler_set_affinity_window(affinity_window);
+	if (aging_interval)
+		scheduler_set_aging(aging_interval);
+	if (scheme == RR && adaptive_latency > 0)
+		scheduler_set_adaptive_quantum(adaptive_latency, quantum);
+	if (cpu_speed != NULL && !speed_oblivious)
+		scheduler_set_core_speeds(cpu_speed);
+	if (queue_limit >= 0)
+		scheduler_set_queue_limit(queue_limit, admission);
+
+	if (log_file != NULL)
+	{
+		decision_log_config_t log_config = { cores, (policy != NULL) ? -1 : scheme, (scheme == CFS) ? latency : 0,
+				per_core_queues, affinity_window, aging_interval, (scheme == RR) ? adaptive_latency : 0, quantum,
+				queue_limit, admission, (cpu_speed != NULL && !speed_oblivious) ? cpu_speed : NULL, policy_file };
+
+		decision_log = decision_log_create(log_file, &log_config);
+		if (decision_log == NULL)
+		{
+			fprintf(stderr, "Unable to create the decision log \"%s\".\n", log_file);
+			return 1;
+		}
+	}
+
+	int time_sliced = (scheme == RR || scheme == CFS || scheme == STRIDE || quantum > 0);
+
+
+	scheduler_time_t time = 0;
+	int i, j, k;
+	int active_jobs = job_id, jobs_alive = 0, jobs_blocked = 0;
+	long long busy_core_ticks = 0;
+
+	// Arrivals and I/O completions to come, earliest first
+	calqueue_t future_events;
+	calqueue_init(&future_events, event_time);
+	scheduler_id_t *waking = malloc(job_id * sizeof(scheduler_id_t));
+	scheduler_id_t *done = malloc(cores * sizeof(scheduler_id_t));
 
+	num_job_ids = job_id;
+	job_index = malloc(job_id * sizeof(int));
+	core_job = malloc(cores * sizeof(scheduler_id_t));
 
-	int time = 0, i, j;
-	int active_jobs = job_id, jobs_alive = 0;
+	// Jobs arriving in the same time unit are handed to the scheduler together
+	scheduler_arrival_t *batch = malloc(job_id * sizeof(scheduler_arrival_t));
+	int *batch_index = malloc(job_id * sizeof(int));
+	int *batch_cores = malloc(job_id * sizeof(int));
+	scheduler_id_t *shed_ids = malloc(job_id * sizeof(scheduler_id_t));
 
-	int *quantum_clock = malloc(cores * sizeof(int));
+	scheduler_time_t *quantum_clock = malloc(cores * sizeof(scheduler_time_t));
+	scheduler_time_t *core_overhead = malloc(cores * sizeof(scheduler_time_t));
 	char **core_timing_diagram = malloc(cores * sizeof(char *));
 	int core_timing_diagram_size = 1024;
 
 	for (i = 0; i < cores; i++)
 	{
 		quantum_clock[i] = -1;
+		core_overhead[i] = 0;
 		core_timing_diagram[i] = malloc(core_timing_diagram_size + 1);
 		core_timing_diagram[i][0] = '\0';
 	}
 
+	loop_state_t state = { &time, &events, jobs, &active_jobs, &jobs_alive, &jobs_blocked, &busy_core_ticks, &future_events,
+			quantum_clock, core_overhead, core_timing_diagram, &core_timing_diagram_size };
+	unsigned int trace = (checkpoint_file != NULL || restore_file != NULL) ? hash_trace(jobs, job_id) : 0;
+
+	if (restore_file != NULL)
+	{
+		int same_scheme;
+
+		if (!load_checkpoint(restore_file, &state, cores, trace, scheme_name, &same_scheme))
+		{
+			fprintf(stderr, "Unable to resume from \"%s\": not a checkpoint of this trace with the same cores, run queues and core speeds.\n", restore_file);
+			return 2;
+		}
+
+		// The quantum clocks of another scheme mean nothing to this one
+		if (!same_scheme)
+			for (i = 0; i < cores; i++)
+			{
+				quantum_clock[i] = -1;
+				for (j = 0; j < active_jobs; j++)
+					if (jobs[j].core_id == i && time_sliced)
+						quantum_clock[i] = next_quantum(scheme, quantum, i);
+			}
+
+		printf("Resumed at time unit %lld from %s.\n\n", time, restore_file);
+	}
+
+	index_jobs(jobs, active_jobs, cores);
+	for (i = 0; i < active_jobs; i++)
+		if (!jobs[i].arrived && jobs[i].arrival_time >= time)
+			push_event(&future_events, jobs[i].arrival_time, jobs[i].job_id, EVENT_ARRIVAL);
+
+	profile_t loop_profile;
+	if (show_profile)
+		start_profile(&loop_profile);
+
 	while (active_jobs > 0)
 	{
-		printf("=== [TIME %d] ===\n", time);
+		if (time == checkpoint_time)
+		{
+			if (!save_checkpoint(checkpoint_file, &state, cores, trace, scheme_name))
+			{
+				fprintf(stderr, "Unable to write the checkpoint \"%s\".\n", checkpoint_file);
+				return 1;
+			}
+			printf("Checkpoint of time unit %lld written to %s.\n\n", time, checkpoint_file);
+		}
+
+		enter_phase(PHASE_PRINT);
+		printf("=== [TIME %lld] ===\n", time);
 
 		/*
 		 * 1. Check if any jobs finished in the last time unit.
 		 */
-		for (i = 0; i < active_jobs; i++)
+		enter_phase(PHASE_FINISH);
+		// Only running jobs make progress, so only they can be done.  They are
+		// taken in their order in jobs[], which removing a finished job changes.
+		int num_done = 0;
+		for (i = 0; i < cores; i++)
+			if (core_job[i] != -1 && jobs[job_index[core_job[i]]].run_time == 0)
+				done[num_done++] = core_job[i];
+		while (num_done > 0)
 		{
-			if (jobs[i].run_time == 0)
+			int first = 0;
+			for (k = 1; k < num_done; k++)
+				if (job_index[done[k]] < job_index[done[first]])
+					first = k;
+			i = job_index[done[first]];
+			done[first] = done[--num_done];
+
+			if (jobs[i].next_burst < jobs[i].burst_count)
+			{
+				// The CPU burst is over and the job blocks for I/O
+				scheduler_id_t job_id = jobs[i].job_id;
+				int core_id = jobs[i].core_id;
+				unsigned long long call_start = start_call();
+				scheduler_id_t new_job_id = scheduler_job_blocked(core_id, job_id, time);
+				end_call(LOG_JOB_BLOCKED, call_start);
+				count_event(time, &events, snapshot_events);
+				if (decision_log != NULL)
+					decision_log_call(decision_log, LOG_JOB_BLOCKED, core_id, job_id, time, new_job_id);
+
+				if (time_sliced)
+					quantum_clock[core_id] = next_quantum(scheme, quantum, core_id);
+
+				scheduler_time_t wake_time = time + jobs[i].bursts[jobs[i].next_burst];
+				push_event(&future_events, wake_time, job_id, EVENT_IO_DONE);
+
+				vacate_core(&jobs[i]);
+				jobs[i].blocked = 1;
+				jobs[i].run_time = jobs[i].bursts[jobs[i].next_burst + 1];
+				jobs[i].next_burst += 2;
+				jobs_blocked++;
+
+				if ( new_job_id != -1 && !set_active_job(new_job_id, core_id, jobs) )
+				{
+					printf("The scheduler_job_blocked() selected an invalid job (job_id == %lld).\n", new_job_id);
+					print_available_jobs(jobs, active_jobs);
+					return 3;
+				}
+
+				if (new_job_id != -1)
+					charge_switch(core_overhead, core_id, 0);
+
+				printf("Job %lld, running on core %d, blocked for I/O until time %lld. Core %d is now running job %lld.\n", job_id, core_id, wake_time, core_id, new_job_id);
+				printf("  Queue: "); scheduler_show_queue(); printf("\n\n");
+			}
+			else
 			{
 				// Notify the scheduler has finished
-				int job_id = jobs[i].job_id;
+				scheduler_id_t job_id = jobs[i].job_id;
 				int core_id = jobs[i].core_id;
-				int new_job_id = scheduler_job_finished(jobs[i].core_id, jobs[i].job_id, time);
+				unsigned long long call_start = start_call();
+				scheduler_id_t new_job_id = scheduler_job_finished(jobs[i].core_id, jobs[i].job_id, time);
+				end_call(LOG_JOB_FINISHED, call_start);
+				count_event(time, &events, snapshot_events);
+				if (decision_log != NULL)
+					decision_log_call(decision_log, LOG_JOB_FINISHED, core_id, job_id, time, new_job_id);
 
-				if (scheme == RR)
-					quantum_clock[jobs[i].core_id] = quantum;
+				if (time_sliced)
+					quantum_clock[core_id] = next_quantum(scheme, quantum, core_id);
 
 				// Delete the finished jobs, decrease the number of active jobs
-				if (i != active_jobs - 1)
-					memcpy(&jobs[i], &jobs[active_jobs - 1], sizeof(simulator_job_list_t));
-				active_jobs--;
+				active_jobs = remove_job(job_id, jobs, active_jobs);
 				jobs_alive--;
-				i--;
 
 				// Set the new job
-				if ( new_job_id != -1 && !set_active_job(new_job_id, core_id, jobs, active_jobs) )
+				if ( new_job_id != -1 && !set_active_job(new_job_id, core_id, jobs) )
 				{
-					printf("The scheduler_job_finished() selected an invalid job (job_id == %d).\n", new_job_id);
+					printf("The scheduler_job_finished() selected an invalid job (job_id == %lld).\n", new_job_id);
 					print_available_jobs(jobs, active_jobs);
 					return 3;
 				}
 				else
 				{
-					printf("Job %d, running on core %d, finished. Core %d is now running job %d.\n", job_id, core_id, core_id, new_job_id);
+					if (new_job_id != -1)
+						charge_switch(core_overhead, core_id, 0);
+
+					printf("Job %lld, running on core %d, finished. Core %d is now running job %lld.\n", job_id, core_id, core_id, new_job_id);
 					printf("  Queue: "); scheduler_show_queue(); printf("\n\n");
 				}
 			}
@@ -293,40 +1537,42 @@ int main(int argc, char **argv)
 		/*
 		 * 2. Check of any quantums expired in the last time unit.
 		 */
-		if (scheme == RR)
+		enter_phase(PHASE_QUANTUM);
+		if (time_sliced)
 		{
 			for (i = 0; i < cores; i++)
 			{
-				if (quantum_clock[i] == 0)
+				if (quantum_clock[i] == 0 && core_job[i] != -1)
 				{
-					for (j = 0; j < active_jobs; j++)
+					// Notify the scheduler the quantum has expired
+					j = job_index[core_job[i]];
+					int core_id = jobs[j].core_id;
+					scheduler_id_t old_job_id = jobs[j].job_id;
+					unsigned long long call_start = start_call();
+					scheduler_id_t new_job_id = scheduler_quantum_expired(jobs[j].core_id, time);
+					end_call(LOG_QUANTUM_EXPIRED, call_start);
+					count_event(time, &events, snapshot_events);
+					if (decision_log != NULL)
+						decision_log_call(decision_log, LOG_QUANTUM_EXPIRED, core_id, time, 0, new_job_id);
+
+					vacate_core(&jobs[j]);
+
+					quantum_clock[core_id] = next_quantum(scheme, quantum, core_id);
+
+					// Set the new job
+					if ( new_job_id != -1 && !set_active_job(new_job_id, core_id, jobs) )
 					{
-						if (jobs[j].core_id == i)
-						{
-							// Notify the scheduler the quantum has expired
-							int core_id = jobs[j].core_id;
-							int old_job_id = jobs[j].job_id;
-							int new_job_id = scheduler_quantum_expired(jobs[j].core_id, time);
-
-							jobs[j].core_id = -1;
-
-							quantum_clock[core_id] = quantum;
-
-							// Set the new job
-							if ( new_job_id != -1 && !set_active_job(new_job_id, core_id, jobs, active_jobs) )
-							{
-								printf("The scheduler_quantum_expired() selected an invalid job (job_id == %d).\n", new_job_id);
-								print_available_jobs(jobs, active_jobs);
-								return 3;
-							}
-							else
-							{
-								printf("Job %d, running on core %d, had its quantum expire. Core %d is now running job %d.\n", old_job_id, core_id, core_id, new_job_id);
-								printf("  Queue: "); scheduler_show_queue(); printf("\n\n");
-							}
-
-							break;
-						}
+						printf("The scheduler_quantum_expired() selected an invalid job (job_id == %lld).\n", new_job_id);
+						print_available_jobs(jobs, active_jobs);
+						return 3;
+					}
+					else
+					{
+						if (new_job_id != old_job_id && new_job_id != -1)
+							charge_switch(core_overhead, core_id, 1);
+
+						printf("Job %lld, running on core %d, had its quantum expire. Core %d is now running job %lld.\n", old_job_id, core_id, core_id, new_job_id);
+						printf("  Queue: "); scheduler_show_queue(); printf("\n\n");
 					}
 				}
 			}
@@ -334,76 +1580,212 @@ int main(int argc, char **argv)
 
 
 		/*
-		 * 3. Check for any new jobs that arrive in this time unit
+		 * 3. Wake up the jobs whose I/O completed, then check for any new jobs
+		 *    that arrive in this time unit
 		 */
-		for (i = 0; i < active_jobs; i++)
+		enter_phase(PHASE_ARRIVALS);
+		int num_waking = 0, arriving = 0;
+		event_t *event;
+		while ((event = calqueue_peek(&future_events)) != NULL && event->time == time)
 		{
-			if (jobs[i].arrival_time == time)
+			calqueue_poll(&future_events);
+			if (event->kind == EVENT_IO_DONE)
+				waking[num_waking++] = event->job_id;
+			else
+				batch_index[arriving++] = job_index[event->job_id];
+			free(event);
+		}
+
+		// Wake-ups go by job number and arrivals by their order in jobs[]
+		qsort(waking, num_waking, sizeof(scheduler_id_t), compare_ids);
+		qsort(batch_index, arriving, sizeof(int), compare_indices);
+
+		for (k = 0; k < num_waking; k++)
+		{
+			i = job_index[waking[k]];
+			unsigned long long call_start = start_call();
+			int new_job_core_id = scheduler_job_unblocked(jobs[i].job_id, time, jobs[i].run_time);
+			end_call(LOG_JOB_UNBLOCKED, call_start);
+			count_event(time, &events, snapshot_events);
+			if (decision_log != NULL)
+				decision_log_call(decision_log, LOG_JOB_UNBLOCKED, jobs[i].job_id, time, jobs[i].run_time, new_job_core_id);
+			jobs[i].blocked = 0;
+			jobs_blocked--;
+
+			if (new_job_core_id >= 0 && new_job_core_id < cores)
 			{
-				int new_job_core_id = scheduler_new_job(jobs[i].job_id, time, jobs[i].run_time, jobs[i].priority);
-				jobs[i].arrived = 1;
-				jobs_alive++;
+				printf("Job %lld (running time=%lld) completed its I/O. Job %lld is now running on core %d.\n",
+						jobs[i].job_id, jobs[i].run_time, jobs[i].job_id, new_job_core_id);
+				printf("  Queue: "); scheduler_show_queue(); printf("\n\n");
 
-				if (new_job_core_id >= 0 && new_job_core_id < cores)
-				{
-					printf("A new job, job %d (running time=%d, priority=%d), arrived. Job %d is now running on core %d.\n",
-							jobs[i].job_id, jobs[i].run_time, jobs[i].priority, jobs[i].job_id, new_job_core_id);
-					printf("  Queue: "); scheduler_show_queue(); printf("\n\n");
+				take_core(jobs, i, new_job_core_id, core_overhead);
+				if (time_sliced)
+					quantum_clock[new_job_core_id] = next_quantum(scheme, quantum, new_job_core_id);
+			}
+			else if (new_job_core_id == -1)
+			{
+				printf("Job %lld (running time=%lld) completed its I/O. Job %lld is set to idle (-1).\n",
+						jobs[i].job_id, jobs[i].run_time, jobs[i].job_id);
+				printf("  Queue: "); scheduler_show_queue(); printf("\n\n");
+			}
+			else
+			{
+				printf("The scheduler_job_unblocked() selected an invalid core (core_id == %d).\n", new_job_core_id);
+				print_available_cores(cores);
+				return 3;
+			}
+		}
 
-					// Find if anyone is currently using the core.
-					for (j = 0; j < active_jobs; j++)
-						if (jobs[j].core_id == new_job_core_id)
-							jobs[j].core_id = -1;
+		for (k = 0; k < arriving; k++)
+		{
+			i = batch_index[k];
+			batch[k].job_number = jobs[i].job_id;
+			batch[k].running_time = jobs[i].run_time;
+			batch[k].priority = jobs[i].priority;
+			batch[k].deadline = jobs[i].deadline;
+		}
 
-					// Assign the core to the new job
-					jobs[i].core_id = new_job_core_id;
+		if (arriving > 0)
+		{
+			unsigned long long call_start = start_call();
+			scheduler_new_jobs(time, batch, arriving, batch_cores);
+			end_call(LOG_NEW_JOBS, call_start);
+			count_event(time, &events, snapshot_events);
+			if (decision_log != NULL)
+				decision_log_new_jobs(decision_log, time, batch, arriving, batch_cores);
+		}
 
-					if (scheme == RR)
-						quantum_clock[new_job_core_id] = quantum;
-				}
-				else if (new_job_core_id == -1)
-				{
-					printf("A new job, job %d (running time=%d, priority=%d), arrived. Job %d is set to idle (-1).\n",
-							jobs[i].job_id, jobs[i].run_time, jobs[i].priority, jobs[i].job_id);
-					printf("  Queue: "); scheduler_show_queue(); printf("\n\n");
-				}
-				else
-				{
-					printf("The scheduler_new_job() selected an invalid core (core_id == %d).\n", new_job_core_id);
-					print_available_cores(cores);
-					return 3;
-				}
+		for (k = 0; k < arriving; k++)
+		{
+			i = batch_index[k];
+			int new_job_core_id = batch_cores[k];
+			jobs[i].arrived = 1;
+			jobs_alive++;
+
+			if (new_job_core_id >= 0 && new_job_core_id < cores)
+			{
+				printf("A new job, job %lld (running time=%lld, priority=%d), arrived. Job %lld is now running on core %d.\n",
+						jobs[i].job_id, jobs[i].run_time, jobs[i].priority, jobs[i].job_id, new_job_core_id);
+				printf("  Queue: "); scheduler_show_queue(); printf("\n\n");
+
+				// Assign the core to the new job, displacing anyone using it
+				take_core(jobs, i, new_job_core_id, core_overhead);
+
+				if (time_sliced)
+					quantum_clock[new_job_core_id] = next_quantum(scheme, quantum, new_job_core_id);
+			}
+			else if (new_job_core_id == SCHEDULER_SHED)
+			{
+				printf("A new job, job %lld (running time=%lld, priority=%d), arrived. Job %lld was not admitted.\n",
+						jobs[i].job_id, jobs[i].run_time, jobs[i].priority, jobs[i].job_id);
+				printf("  Queue: "); scheduler_show_queue(); printf("\n\n");
+			}
+			else if (new_job_core_id == -1)
+			{
+				printf("A new job, job %lld (running time=%lld, priority=%d), arrived. Job %lld is set to idle (-1).\n",
+						jobs[i].job_id, jobs[i].run_time, jobs[i].priority, jobs[i].job_id);
+				printf("  Queue: "); scheduler_show_queue(); printf("\n\n");
+			}
+			else
+			{
+				printf("The scheduler_new_jobs() selected an invalid core (core_id == %d).\n", new_job_core_id);
+				print_available_cores(cores);
+				return 3;
+			}
+		}
+
+		// Jobs shed by admission control leave the simulation
+		int shed = 0;
+		for (k = 0; k < arriving; k++)
+			if (batch_cores[k] == SCHEDULER_SHED)
+				shed_ids[shed++] = batch[k].job_number;
+		if (queue_limit >= 0)
+		{
+			scheduler_id_t dropped_id;
+			unsigned long long call_start = start_call();
+			while ((dropped_id = scheduler_shed_job()) != -1)
+			{
+				end_call(LOG_SHED_JOB, call_start);
+				if (decision_log != NULL)
+					decision_log_call(decision_log, LOG_SHED_JOB, 0, 0, 0, dropped_id);
+				printf("Job %lld was dropped from the queue to admit a new job.\n\n", dropped_id);
+				shed_ids[shed++] = dropped_id;
+				call_start = start_call();
 			}
+			end_call(LOG_SHED_JOB, call_start);
+			if (decision_log != NULL && arriving > 0)
+				decision_log_call(decision_log, LOG_SHED_JOB, 0, 0, 0, -1);
+		}
+		for (k = 0; k < shed; k++)
+		{
+			active_jobs = remove_job(shed_ids[k], jobs, active_jobs);
+			jobs_alive--;
 		}
 
 
 		/*
 		 * 4. Run the time unit.
 		 */
-		char time_string[cores][11];
+		enter_phase(PHASE_RUN);
+		char time_string[cores][24];
 		int cores_working = 0;
 
 		for (i = 0; i < cores; i++)
 			time_string[i][0] = '\0';
 
-		for (i = 0; i < active_jobs; i++)
+		for (k = 0; k < cores; k++)
 		{
-			if (jobs[i].core_id != -1)
+			if (core_job[k] != -1)
 			{
+				i = job_index[core_job[k]];
 				cores_working++;
-				jobs[i].run_time--;
-				quantum_clock[jobs[i].core_id]--;
+
+				// During dispatch overhead the core is busy but the job does not run
+				if (core_overhead[jobs[i].core_id] > 0)
+				{
+					core_overhead[jobs[i].core_id]--;
+					overhead_ticks++;
+					stall_core(jobs[i].core_id);
+					assert(time_string[jobs[i].core_id][0] == '\0');
+					strcpy(time_string[jobs[i].core_id], "*");
+					continue;
+				}
+
+				// Warm-up after a migration does not use up the quantum, or a
+				// penalty longer than the quantum would never let the job progress
+				if (jobs[i].warmup > 0)
+				{
+					jobs[i].warmup--;
+					stall_core(jobs[i].core_id);
+				}
+				else
+				{
+					int units = 1;
+					if (cpu_speed != NULL)
+					{
+						int core_id = jobs[i].core_id;
+						cpu_credit[core_id] += cpu_speed[core_id];
+						units = cpu_credit[core_id] / SCHEDULER_SPEED_UNIT;
+						cpu_credit[core_id] %= SCHEDULER_SPEED_UNIT;
+						if (units > jobs[i].run_time)
+							units = jobs[i].run_time;
+						cpu_busy_ticks[core_id]++;
+					}
+					jobs[i].run_time -= units;
+					quantum_clock[jobs[i].core_id]--;
+					useful_ticks++;
+				}
 
 				assert(time_string[jobs[i].core_id][0] == '\0');
 
 				if (jobs[i].job_id < 10)
-					sprintf(time_string[jobs[i].core_id], "%d", jobs[i].job_id);
+					sprintf(time_string[jobs[i].core_id], "%lld", jobs[i].job_id);
 				else if (jobs[i].job_id < 10 + 26)
-					sprintf(time_string[jobs[i].core_id], "%c", jobs[i].job_id - 10 + 'a');
+					sprintf(time_string[jobs[i].core_id], "%c", (int)(jobs[i].job_id - 10 + 'a'));
 				else if (jobs[i].job_id < 10 + 26 + 26)
-					sprintf(time_string[jobs[i].core_id], "%c", jobs[i].job_id - 10 - 26 + 'A');
+					sprintf(time_string[jobs[i].core_id], "%c", (int)(jobs[i].job_id - 10 - 26 + 'A'));
 				else
-					snprintf(time_string[jobs[i].core_id], 10, "(%d)", jobs[i].job_id);
+					snprintf(time_string[jobs[i].core_id], sizeof(time_string[0]), "(%lld)", jobs[i].job_id);
 			}
 		}
 
@@ -437,7 +1819,8 @@ int main(int argc, char **argv)
 		/*
 		 * 5. Print data!
 		 */
-		printf("At the end of time unit %d...\n", time);
+		enter_phase(PHASE_PRINT);
+		printf("At the end of time unit %lld...\n", time);
 
 		for (i = 0; i < cores; i++)
 			printf("  Core %2d: %s\n", i, core_timing_diagram[i]);
@@ -455,7 +1838,9 @@ int main(int argc, char **argv)
 		 *
 		 * - If there's a job alive (needing to be ran) and all CPUs are idle, the scheduler failed to schedule properly.
 		 */
-		if (jobs_alive > 0 && cores_working == 0)
+		enter_phase(PHASE_SANITY);
+		busy_core_ticks += cores_working;
+		if (jobs_alive - jobs_blocked > 0 && cores_working == 0)
 		{
 			printf("All cores are idle and at least one job remains unscheduled.\n");
 			print_available_jobs(jobs, active_jobs);
@@ -463,13 +1848,25 @@ int main(int argc, char **argv)
 		}
 
 
+		if (snapshot_ticks > 0 && (time + 1) % snapshot_ticks == 0)
+			print_snapshot(time + 1);
+
+
 		/*
 		 * 7. Increase time
 		 */
 		time++;
+		if (profile != NULL)
+			profile->ticks++;
 	}
 
 
+	if (profile != NULL)
+		stop_profile();
+
+	if (checkpoint_time > time)
+		fprintf(stderr, "The simulation ended at time unit %lld, before the checkpoint of time unit %lld.\n", time, checkpoint_time);
+
 	printf("FINAL TIMING DIAGRAM:\n");
 	for (i = 0; i < cores; i++)
 		printf("  Core %2d: %s\n", i, core_timing_diagram[i]);
@@ -479,10 +1876,96 @@ int main(int argc, char **argv)
 	printf("Average Turnaround Time: %.2f\n", scheduler_average_turnaround_time());
 	printf("Average Response Time: %.2f\n", scheduler_average_response_time());
 
+	if (has_deadlines)
+	{
+		printf("Deadline Misses: %lld of %lld (%.2f%%)\n", scheduler_deadline_misses(), scheduler_deadline_jobs(), 100.0 * scheduler_deadline_miss_ratio());
+		printf("Lateness p50/p90/p99/max: %lld/%lld/%lld/%lld\n", scheduler_lateness_percentile(50), scheduler_lateness_percentile(90),
+				scheduler_lateness_percentile(99), scheduler_lateness_percentile(100));
+	}
+
+	if (has_bursts)
+	{
+		printf("\nCPU utilization: %.2f%%\n", time > 0 ? 100.0 * busy_core_ticks / ((double)cores * time) : 0.0);
+		printf("I/O response time (I/O completion to dispatch) mean/p50/p90/p99/max: %.2f/%lld/%lld/%lld/%lld\n",
+				scheduler_latency_mean(METRIC_IO_RESPONSE), scheduler_latency_percentile(METRIC_IO_RESPONSE, 50),
+				scheduler_latency_percentile(METRIC_IO_RESPONSE, 90), scheduler_latency_percentile(METRIC_IO_RESPONSE, 99),
+				scheduler_latency_percentile(METRIC_IO_RESPONSE, 100));
+	}
+
+	if (queue_limit >= 0)
+	{
+		const char *admission_names[] = { "rejecting new jobs", "dropping the lowest priority", "dropping the oldest" };
+		long long rejected = scheduler_rejected_jobs(), dropped = scheduler_dropped_jobs();
+
+		printf("\nAdmission control (queue depth %d, %s): %lld of %lld jobs shed (%.2f%%),\n", queue_limit, admission_names[admission],
+				rejected + dropped, job_id, job_id > 0 ? 100.0 * (rejected + dropped) / job_id : 0.0);
+		printf("  %lld turned away on arrival, %lld dropped from the queue; latencies are of the %lld admitted jobs\n",
+				rejected, dropped, job_id - rejected - dropped);
+	}
+
+	if (model_overhead)
+	{
+		printf("\nContext switches: %lld (%.2f per job), %lld of them preemptions\n", switches, (float)switches / job_id, preemptions);
+		printf("Dispatch overhead: %lld time unit(s)\n", overhead_ticks);
+		printf("Effective utilization: %.2f%%\n", time > 0 ? 100.0 * useful_ticks / ((double)cores * time) : 0.0);
+	}
+	else if (adaptive_latency > 0)
+		printf("\nContext switches: %lld (%.2f per job)\n", switches, (float)switches / job_id);
+
+	if (cpu_speed != NULL)
+	{
+		printf("\nMakespan: %lld time unit(s) with %s placement\n", time, speed_oblivious ? "speed-oblivious" : "speed-aware");
+		printf("Per-core speed / utilization:\n");
+		for (i = 0; i < cores; i++)
+			printf("  Core %2d: %5.2f / %6.2f%%\n", i, (double)cpu_speed[i] / SCHEDULER_SPEED_UNIT, time > 0 ? 100.0 * cpu_busy_ticks[i] / time : 0.0);
+	}
+
+	if (model_migrations)
+		printf("\nMigrations: %lld, costing %lld time unit(s) of warm-up\n", migrations, migration_ticks);
+
+	if (per_core_queues)
+	{
+		printf("\nPer-core run queues (average length / steals):\n");
+		for (i = 0; i < cores; i++)
+			printf("  Core %2d: %6.2f / %lld\n", i, scheduler_average_queue_length(i), scheduler_steals(i));
+	}
+
+	if (show_shares)
+	{
+		printf("\nCPU share under contention (achieved / entitled):\n");
+		for (i = min_priority; i <= max_priority; i++)
+			if (scheduler_cpu_share(i) > 0 || scheduler_entitled_share(i) > 0)
+				printf("  Priority %3d: %6.2f%% / %6.2f%%\n", i, 100.0 * scheduler_cpu_share(i), 100.0 * scheduler_entitled_share(i));
+	}
+
+	if (show_percentiles)
+		print_percentiles(min_priority, max_priority, has_bursts);
+
+	if (show_stats)
+		print_scheduler_stats();
+
+	if (profile != NULL)
+		print_profile();
+
 	scheduler_clean_up();
+	if (decision_log != NULL)
+		decision_log_close(decision_log);
 
 
+	calqueue_destroy(&future_events);
+	free(waking);
+	free(done);
+	free(job_index);
+	free(core_job);
 	free(quantum_clock);
+	free(core_overhead);
+	free(batch);
+	free(batch_index);
+	free(batch_cores);
+	free(shed_ids);
+	free(cpu_speed);
+	free(cpu_credit);
+	free(cpu_busy_ticks);
 	for (i=0; i < cores; i++)
 		free(core_timing_diagram[i]);
 	free(core_timing_diagram);
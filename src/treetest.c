@@ -0,0 +1,115 @@
+/** @file treetest.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "librbtree/librbtree.h"
+
+int compare1(const void * a, const void * b)
+{
+	return ( *(int*)a - *(int*)b );
+}
+
+/* Checks the red-black properties, returns the black height or -1. */
+int black_height(RBNode *n)
+{
+	if (n == NULL)
+		return 1;
+
+	if (n->red && ((n->left && n->left->red) || (n->right && n->right->red)))
+		return -1;
+
+	int l = black_height(n->left);
+	int r = black_height(n->right);
+	if (l == -1 || r == -1 || l != r)
+		return -1;
+
+	return l + !n->red;
+}
+
+int main()
+{
+	rbtree_t t;
+
+	rbtree_init(&t, compare1);
+
+	/* Pupulate some data... */
+	int *values = malloc(1000 * sizeof(int));
+
+	int i;
+	for (i = 0; i < 1000; i++)
+		values[i] = i;
+
+	rbtree_insert(&t, &values[14]);
+	rbtree_insert(&t, &values[12]);
+	rbtree_insert(&t, &values[13]);
+	printf("Total elements: %d (expected 3).\n", rbtree_size(&t));
+	printf("Min element: %d (expected 12).\n", *((int *)rbtree_min(&t)));
+
+	int val = *((int *)rbtree_poll_min(&t));
+	printf("Polled element: %d (expected 12).\n", val);
+	printf("Min element: %d (expected 13).\n", *((int *)rbtree_min(&t)));
+
+	printf("Elements removed: %d (expected 1).\n", rbtree_remove(&t, &values[14]));
+	printf("Elements removed: %d (expected 0).\n", rbtree_remove(&t, &values[14]));
+	printf("Total elements: %d (expected 1).\n", rbtree_size(&t));
+
+	rbtree_insert(&t, &values[30]);
+	rbtree_insert(&t, &values[10]);
+	rbtree_insert(&t, &values[20]);
+
+	printf("Elements in order (expected 10 13 20 30): ");
+	for (i = 0; i < rbtree_size(&t); i++)
+		printf("%d ", *((int *)rbtree_at(&t, i)) );
+	printf("\n");
+
+	/* Scrambled inserts and removals keep the tree balanced and sorted. */
+	for (i = 0; i < 1000; i++)
+	{
+		int v = (i * 7919) % 1000;
+		if (v != 10 && v != 13 && v != 20 && v != 30)
+			rbtree_insert(&t, &values[v]);
+	}
+	for (i = 0; i < 1000; i += 3)
+		rbtree_remove(&t, &values[(i * 104729) % 1000]);
+
+	int sorted = 1;
+	for (i = 1; i < rbtree_size(&t); i++)
+		if (*((int *)rbtree_at(&t, i - 1)) >= *((int *)rbtree_at(&t, i)))
+			sorted = 0;
+	printf("Total elements: %d (expected 666).\n", rbtree_size(&t));
+	printf("Sorted: %d, balanced: %d (expected 1, 1).\n", sorted, black_height(t.root) != -1);
+
+	int last = -1;
+	sorted = 1;
+	while (rbtree_size(&t) > 0)
+	{
+		val = *((int *)rbtree_poll_min(&t));
+		if (val <= last)
+			sorted = 0;
+		last = val;
+	}
+	printf("Drained in order: %d (expected 1).\n", sorted);
+
+	/* Lookups by key. */
+	for (i = 0; i < 10; i++)
+		rbtree_insert(&t, &values[i]);
+	int key = 7;
+	printf("Found: %d (expected 7).\n", *((int *)rbtree_find(&t, &key)));
+	key = 42;
+	printf("Find missing: %p (expected (nil)).\n", rbtree_find(&t, &key));
+
+	/* The whole tree in order at once. */
+	void *all[10];
+	printf("As an array (expected 10 elements 0 1 2 3 4 5 6 7 8 9): %d elements", rbtree_to_array(&t, all));
+	for (i = 0; i < 10; i++)
+		printf(" %d", *((int *)all[i]));
+	printf("\n");
+
+	rbtree_destroy(&t);
+
+	free(values);
+
+	return 0;
+}